@@ -0,0 +1,142 @@
+#include "audio-encoder.h"
+#include <obs-module.h>
+#include "plugin-support.h"
+
+#include <algorithm>
+
+#ifdef ENABLE_OPUS
+#include <opus.h>
+
+// Largest Opus packet for a single frame
+static const size_t MAX_OPUS_PACKET = 1275;
+
+// Opus packet durations, longest first; the longest one dividing the frame is used.
+// Longer packets would hold captions back by a whole packet.
+static const int OPUS_PACKET_MS[] = {20, 10};
+#endif
+
+AudioEncoder::AudioEncoder() : activeFormat(Format::Pcm), sampleRate(0), packetSamples(0), opus(nullptr) {}
+
+AudioEncoder::~AudioEncoder()
+{
+	release();
+}
+
+bool AudioEncoder::opusAvailable()
+{
+#ifdef ENABLE_OPUS
+	return true;
+#else
+	return false;
+#endif
+}
+
+const char *AudioEncoder::formatName(Format format)
+{
+	return format == Format::Opus ? "opus" : "s16le";
+}
+
+void AudioEncoder::release()
+{
+#ifdef ENABLE_OPUS
+	if (opus) {
+		opus_encoder_destroy(opus);
+	}
+#endif
+	opus = nullptr;
+}
+
+bool AudioEncoder::configure(Format format, uint32_t rate, int frameMs)
+{
+	release();
+	activeFormat = Format::Pcm;
+	sampleRate = rate;
+	packetSamples = 0;
+
+	if (format == Format::Pcm) {
+		return true;
+	}
+
+#ifdef ENABLE_OPUS
+	int packet = 0;
+	for (int ms : OPUS_PACKET_MS) {
+		if (frameMs % ms == 0) {
+			packet = ms;
+			break;
+		}
+	}
+	if (packet == 0) {
+		obs_log(LOG_WARNING, "[Entei] %d ms frames cannot be split into Opus packets, sending PCM", frameMs);
+		return false;
+	}
+
+	int error = OPUS_OK;
+	opus = opus_encoder_create((opus_int32)rate, 1, OPUS_APPLICATION_RESTRICTED_LOWDELAY, &error);
+	if (error != OPUS_OK || !opus) {
+		obs_log(LOG_WARNING, "[Entei] Opus encoder unavailable at %u Hz (%s), sending PCM", rate,
+			opus_strerror(error));
+		opus = nullptr;
+		return false;
+	}
+	opus_encoder_ctl(opus, OPUS_SET_BITRATE(OPUS_BITRATE));
+	opus_encoder_ctl(opus, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+	// Speech recognition gains little from the top complexity settings
+	opus_encoder_ctl(opus, OPUS_SET_COMPLEXITY(5));
+
+	activeFormat = Format::Opus;
+	packetSamples = (size_t)rate * (size_t)packet / 1000;
+	return true;
+#else
+	UNUSED_PARAMETER(frameMs);
+	obs_log(LOG_WARNING, "[Entei] Built without Opus support, sending PCM");
+	return false;
+#endif
+}
+
+int AudioEncoder::packetMs() const
+{
+	return activeFormat == Format::Opus && sampleRate > 0 ? (int)(packetSamples * 1000 / sampleRate) : 0;
+}
+
+bool AudioEncoder::encode(const int16_t *samples, size_t count, std::vector<uint8_t> &out)
+{
+	size_t start = out.size();
+	if (activeFormat == Format::Pcm) {
+		out.resize(start + count * sizeof(int16_t));
+		uint8_t *bytes = out.data() + start;
+		for (size_t i = 0; i < count; i++) {
+			uint16_t sample = (uint16_t)samples[i];
+			bytes[2 * i] = (uint8_t)(sample & 0xFF);
+			bytes[2 * i + 1] = (uint8_t)(sample >> 8);
+		}
+		return true;
+	}
+
+#ifdef ENABLE_OPUS
+	for (size_t offset = 0; offset < count; offset += packetSamples) {
+		const int16_t *packet = samples + offset;
+		if (count - offset < packetSamples) {
+			// Frames always fill whole packets; pad anything else with silence
+			padded.assign(packetSamples, 0);
+			std::copy(packet, samples + count, padded.begin());
+			packet = padded.data();
+		}
+
+		size_t header = out.size();
+		out.resize(header + 2 + MAX_OPUS_PACKET);
+		opus_int32 size = opus_encode(opus, packet, (int)packetSamples, out.data() + header + 2,
+					      (opus_int32)MAX_OPUS_PACKET);
+		if (size < 0) {
+			obs_log(LOG_ERROR, "[Entei] Opus encoding failed: %s", opus_strerror(size));
+			out.resize(start);
+			return false;
+		}
+		out[header] = (uint8_t)(size & 0xFF);
+		out[header + 1] = (uint8_t)(size >> 8);
+		out.resize(header + 2 + (size_t)size);
+	}
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct OpusEncoder;
+
+// Turns uplink audio into WebSocket payloads: raw s16le, or Opus when the
+// plugin is built with ENABLE_OPUS.
+//
+// 16 kHz PCM costs 256 kbit/s; Opus carries speech at a tenth of that, which
+// matters when the transcriber sits across a WAN link. Opus runs in its
+// restricted low-delay mode, without the speech mode's lookahead, and with
+// packets of at most 20 ms that divide the uplink frame, so encoding adds no
+// buffering of its own. A message holds one or more packets, each preceded
+// by its size as a 16-bit little-endian integer. PCM samples are written
+// little-endian whatever the host order.
+//
+// Encoding is only ever done on the network thread, never in the OBS audio
+// callback.
+class AudioEncoder {
+public:
+	enum class Format { Pcm, Opus };
+
+	static constexpr int OPUS_BITRATE = 24000;
+
+	AudioEncoder();
+	~AudioEncoder();
+
+	AudioEncoder(const AudioEncoder &) = delete;
+	AudioEncoder &operator=(const AudioEncoder &) = delete;
+
+	static bool opusAvailable();
+	static const char *formatName(Format format);
+
+	// Returns false, falling back to PCM, when Opus is unavailable or cannot take the rate
+	bool configure(Format format, uint32_t sampleRate, int frameMs);
+	Format format() const { return activeFormat; }
+	// Duration of one Opus packet, 0 for PCM
+	int packetMs() const;
+
+	// Appends the payload for one message to out
+	bool encode(const int16_t *samples, size_t count, std::vector<uint8_t> &out);
+
+private:
+	void release();
+
+	Format activeFormat;
+	uint32_t sampleRate;
+	size_t packetSamples;
+	OpusEncoder *opus;
+	std::vector<int16_t> padded;
+};
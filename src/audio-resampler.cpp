@@ -0,0 +1,442 @@
+#include "audio-resampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RESAMPLER_SSE2
+#if defined(__GNUC__) || defined(_MSC_VER)
+// AVX2 kernels are compiled alongside the baseline ones and only used when the CPU has it
+#include <immintrin.h>
+#define RESAMPLER_AVX2
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RESAMPLER_NEON
+#endif
+
+namespace {
+
+// Taps per input sample of the rate change; 96 taps per output at 48 kHz keep
+// aliasing well down while passing speech up to 7 kHz
+constexpr uint32_t TAPS_PER_FACTOR = 32;
+// Passband edge as a fraction of the output Nyquist frequency
+constexpr double CUTOFF = 0.9;
+
+constexpr float PCM16_SCALE = 32767.0f;
+
+constexpr double PI = 3.14159265358979323846;
+
+struct Kernels {
+	const char *name;
+	// out[i] = average of planes[c][i]; null planes count as silence
+	void (*downmix)(const float *const *planes, uint32_t channels, size_t frames, float *out);
+	// out[o] = dot(in + o * stride, taps, size); size is a multiple of 8
+	void (*decimate)(const float *in, size_t outputs, size_t stride, const float *taps, size_t size, float *out);
+	// Clamps to [-1, 1] and rounds to the nearest int16
+	void (*to_int16)(const float *in, size_t size, int16_t *out);
+};
+
+void downmix_scalar(const float *const *planes, uint32_t channels, size_t frames, float *out)
+{
+	float scale = 1.0f / (float)channels;
+	for (size_t i = 0; i < frames; i++) {
+		float sum = 0.0f;
+		for (uint32_t c = 0; c < channels; c++) {
+			if (planes[c]) {
+				sum += planes[c][i];
+			}
+		}
+		out[i] = sum * scale;
+	}
+}
+
+#if !defined(RESAMPLER_SSE2) && !defined(RESAMPLER_NEON)
+void decimate_scalar(const float *in, size_t outputs, size_t stride, const float *taps, size_t size, float *out)
+{
+	for (size_t o = 0; o < outputs; o++) {
+		const float *window = in + o * stride;
+		float sum = 0.0f;
+		for (size_t k = 0; k < size; k++) {
+			sum += window[k] * taps[k];
+		}
+		out[o] = sum;
+	}
+}
+#endif
+
+void to_int16_scalar(const float *in, size_t size, int16_t *out)
+{
+	for (size_t i = 0; i < size; i++) {
+		float sample = std::clamp(in[i], -1.0f, 1.0f);
+		out[i] = (int16_t)std::lrint(sample * PCM16_SCALE);
+	}
+}
+
+#ifdef RESAMPLER_SSE2
+float horizontal_sum(__m128 v)
+{
+	__m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+}
+
+void downmix_sse2(const float *const *planes, uint32_t channels, size_t frames, float *out)
+{
+	float scale = 1.0f / (float)channels;
+	__m128 scale4 = _mm_set1_ps(scale);
+	size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		__m128 sum = _mm_setzero_ps();
+		for (uint32_t c = 0; c < channels; c++) {
+			if (planes[c]) {
+				sum = _mm_add_ps(sum, _mm_loadu_ps(planes[c] + i));
+			}
+		}
+		_mm_storeu_ps(out + i, _mm_mul_ps(sum, scale4));
+	}
+	const float *tail[8] = {};
+	for (uint32_t c = 0; c < channels && c < 8; c++) {
+		tail[c] = planes[c] ? planes[c] + i : nullptr;
+	}
+	downmix_scalar(tail, std::min(channels, 8u), frames - i, out + i);
+}
+
+void decimate_sse2(const float *in, size_t outputs, size_t stride, const float *taps, size_t size, float *out)
+{
+	for (size_t o = 0; o < outputs; o++) {
+		const float *window = in + o * stride;
+		__m128 sum0 = _mm_setzero_ps();
+		__m128 sum1 = _mm_setzero_ps();
+		for (size_t k = 0; k < size; k += 8) {
+			sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(window + k), _mm_loadu_ps(taps + k)));
+			sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(window + k + 4), _mm_loadu_ps(taps + k + 4)));
+		}
+		out[o] = horizontal_sum(_mm_add_ps(sum0, sum1));
+	}
+}
+
+void to_int16_sse2(const float *in, size_t size, int16_t *out)
+{
+	const __m128 low = _mm_set1_ps(-1.0f);
+	const __m128 high = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(PCM16_SCALE);
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		__m128 a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), low), high), scale);
+		__m128 b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), low), high), scale);
+		__m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+	}
+	to_int16_scalar(in + i, size - i, out + i);
+}
+#endif
+
+#ifdef RESAMPLER_AVX2
+AVX2_TARGET void downmix_avx2(const float *const *planes, uint32_t channels, size_t frames, float *out)
+{
+	__m256 scale = _mm256_set1_ps(1.0f / (float)channels);
+	size_t i = 0;
+	for (; i + 8 <= frames; i += 8) {
+		__m256 sum = _mm256_setzero_ps();
+		for (uint32_t c = 0; c < channels; c++) {
+			if (planes[c]) {
+				sum = _mm256_add_ps(sum, _mm256_loadu_ps(planes[c] + i));
+			}
+		}
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(sum, scale));
+	}
+	const float *tail[8] = {};
+	for (uint32_t c = 0; c < channels && c < 8; c++) {
+		tail[c] = planes[c] ? planes[c] + i : nullptr;
+	}
+	downmix_scalar(tail, std::min(channels, 8u), frames - i, out + i);
+}
+
+AVX2_TARGET void decimate_avx2(const float *in, size_t outputs, size_t stride, const float *taps, size_t size,
+			       float *out)
+{
+	for (size_t o = 0; o < outputs; o++) {
+		const float *window = in + o * stride;
+		__m256 sum = _mm256_setzero_ps();
+		for (size_t k = 0; k < size; k += 8) {
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(window + k), _mm256_loadu_ps(taps + k)));
+		}
+		__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+		out[o] = horizontal_sum(half);
+	}
+}
+
+AVX2_TARGET void to_int16_avx2(const float *in, size_t size, int16_t *out)
+{
+	const __m256 low = _mm256_set1_ps(-1.0f);
+	const __m256 high = _mm256_set1_ps(1.0f);
+	const __m256 scale = _mm256_set1_ps(PCM16_SCALE);
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16) {
+		__m256 a = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i), low), high), scale);
+		__m256 b = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i + 8), low), high), scale);
+		// Packing works per 128-bit lane, so put the quarters back in order afterwards
+		__m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+		packed = _mm256_permute4x64_epi64(packed, 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+	}
+	to_int16_sse2(in + i, size - i, out + i);
+}
+
+bool cpu_has_avx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	// The OS must also save the YMM registers across context switches
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+#ifdef RESAMPLER_NEON
+void downmix_neon(const float *const *planes, uint32_t channels, size_t frames, float *out)
+{
+	float scale = 1.0f / (float)channels;
+	size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		float32x4_t sum = vdupq_n_f32(0.0f);
+		for (uint32_t c = 0; c < channels; c++) {
+			if (planes[c]) {
+				sum = vaddq_f32(sum, vld1q_f32(planes[c] + i));
+			}
+		}
+		vst1q_f32(out + i, vmulq_n_f32(sum, scale));
+	}
+	const float *tail[8] = {};
+	for (uint32_t c = 0; c < channels && c < 8; c++) {
+		tail[c] = planes[c] ? planes[c] + i : nullptr;
+	}
+	downmix_scalar(tail, std::min(channels, 8u), frames - i, out + i);
+}
+
+void decimate_neon(const float *in, size_t outputs, size_t stride, const float *taps, size_t size, float *out)
+{
+	for (size_t o = 0; o < outputs; o++) {
+		const float *window = in + o * stride;
+		float32x4_t sum0 = vdupq_n_f32(0.0f);
+		float32x4_t sum1 = vdupq_n_f32(0.0f);
+		for (size_t k = 0; k < size; k += 8) {
+			sum0 = vfmaq_f32(sum0, vld1q_f32(window + k), vld1q_f32(taps + k));
+			sum1 = vfmaq_f32(sum1, vld1q_f32(window + k + 4), vld1q_f32(taps + k + 4));
+		}
+		out[o] = vaddvq_f32(vaddq_f32(sum0, sum1));
+	}
+}
+
+void to_int16_neon(const float *in, size_t size, int16_t *out)
+{
+	const float32x4_t low = vdupq_n_f32(-1.0f);
+	const float32x4_t high = vdupq_n_f32(1.0f);
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		float32x4_t a = vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(in + i), low), high), PCM16_SCALE);
+		float32x4_t b = vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(in + i + 4), low), high), PCM16_SCALE);
+		int16x8_t packed = vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b)));
+		vst1q_s16(out + i, packed);
+	}
+	to_int16_scalar(in + i, size - i, out + i);
+}
+#endif
+
+Kernels select_kernels()
+{
+#ifdef RESAMPLER_AVX2
+	if (cpu_has_avx2()) {
+		return {"AVX2", downmix_avx2, decimate_avx2, to_int16_avx2};
+	}
+#endif
+#if defined(RESAMPLER_SSE2)
+	return {"SSE2", downmix_sse2, decimate_sse2, to_int16_sse2};
+#elif defined(RESAMPLER_NEON)
+	return {"NEON", downmix_neon, decimate_neon, to_int16_neon};
+#else
+	return {"scalar", downmix_scalar, decimate_scalar, to_int16_scalar};
+#endif
+}
+
+const Kernels &kernels()
+{
+	static const Kernels selected = select_kernels();
+	return selected;
+}
+
+// Blackman-windowed sinc low-pass at the input rate times up, split into up
+// phases of phaseSize taps that each have unity gain at DC
+std::vector<float> design_low_pass(uint32_t up, uint32_t down, size_t &phaseSize)
+{
+	uint32_t factor = std::max(up, down);
+	size_t size = (size_t)TAPS_PER_FACTOR * factor;
+	double cutoff = CUTOFF * 0.5 / factor; // Cycles per upsampled input sample
+	double center = (size - 1) / 2.0;
+	std::vector<double> taps(size);
+	double sum = 0.0;
+	for (size_t k = 0; k < size; k++) {
+		double x = k - center;
+		double sinc = x == 0.0 ? 2.0 * cutoff : std::sin(2.0 * PI * cutoff * x) / (PI * x);
+		double phase = 2.0 * PI * k / (size - 1);
+		double window = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+		taps[k] = sinc * window;
+		sum += taps[k];
+	}
+
+	// Phase p holds taps p, p + up, p + 2 up, ...; reversed, so the oldest input meets the last tap
+	phaseSize = ((size + up - 1) / up + 7) / 8 * 8;
+	std::vector<float> result(up * phaseSize, 0.0f);
+	for (size_t k = 0; k < size; k++) {
+		result[(k % up) * phaseSize + phaseSize - 1 - k / up] = (float)(taps[k] * up / sum);
+	}
+	return result;
+}
+
+} // namespace
+
+AudioResampler::AudioResampler()
+	: inputRate(TARGET_RATE),
+	  channels(1),
+	  up(1),
+	  down(1),
+	  phaseSize(0),
+	  position(0),
+	  totalNs(0),
+	  totalFrames(0)
+{
+}
+
+void AudioResampler::configure(uint32_t rate, uint32_t channelCount)
+{
+	inputRate = rate > 0 ? rate : TARGET_RATE;
+	channels = std::max(channelCount, 1u);
+	uint32_t divisor = std::gcd(inputRate, TARGET_RATE);
+	up = TARGET_RATE / divisor;
+	down = inputRate / divisor;
+	phaseSize = 0;
+	taps = up > 1 || down > 1 ? design_low_pass(up, down, phaseSize) : std::vector<float>();
+	reset();
+}
+
+void AudioResampler::reset()
+{
+	// Start from silence so the first buffer already produces output
+	mono.assign(phaseSize > 0 ? phaseSize - 1 : 0, 0.0f);
+	position = phaseSize > 0 ? (uint64_t)(phaseSize - 1) * up : 0;
+	totalNs = 0;
+	totalFrames = 0;
+}
+
+uint32_t AudioResampler::outputRate() const
+{
+	return (uint32_t)((uint64_t)inputRate * up / down);
+}
+
+void AudioResampler::downmix(const float *const *planes, uint32_t channels, size_t frames, float *out)
+{
+	kernels().downmix(planes, std::max(channels, 1u), frames, out);
+}
+
+void AudioResampler::process(const float *const *planes, uint32_t frames, bool muted, std::vector<int16_t> &out)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	size_t base = mono.size();
+	mono.resize(base + frames);
+	if (muted) {
+		std::fill(mono.begin() + base, mono.end(), 0.0f);
+	} else {
+		kernels().downmix(planes, channels, frames, mono.data() + base);
+	}
+	convert(out);
+
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	totalNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	totalFrames += frames;
+}
+
+void AudioResampler::processMono(const float *samples, size_t frames, std::vector<int16_t> &out)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	mono.insert(mono.end(), samples, samples + frames);
+	convert(out);
+
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	totalNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	totalFrames += frames;
+}
+
+void AudioResampler::convert(std::vector<int16_t> &out)
+{
+	const Kernels &k = kernels();
+	const float *converted = mono.data();
+	size_t count = mono.size();
+	size_t consumed = count;
+	if (phaseSize > 0) {
+		// An output is due once its newest input has arrived, and reads the phaseSize inputs up to it
+		filtered.clear();
+		if (up == 1) {
+			// Whole-number ratios use a single phase, so the kernel strides through all outputs at once
+			size_t outputs = position < mono.size() ? (mono.size() - 1 - position) / down + 1 : 0;
+			filtered.resize(outputs);
+			k.decimate(mono.data() + position + 1 - phaseSize, outputs, down, taps.data(), phaseSize,
+				   filtered.data());
+			position += (uint64_t)outputs * down;
+		} else {
+			while (position / up < mono.size()) {
+				size_t newest = (size_t)(position / up);
+				float sample;
+				k.decimate(mono.data() + newest + 1 - phaseSize, 1, 0,
+					   taps.data() + (position % up) * phaseSize, phaseSize, &sample);
+				filtered.push_back(sample);
+				position += down;
+			}
+		}
+		converted = filtered.data();
+		count = filtered.size();
+
+		// What the next output no longer reads is dropped; the rest stays as history
+		consumed = (size_t)std::min<uint64_t>(position / up + 1 - phaseSize, mono.size());
+		position -= (uint64_t)consumed * up;
+	}
+
+	size_t offset = out.size();
+	out.resize(offset + count);
+	k.to_int16(converted, count, out.data() + offset);
+	mono.erase(mono.begin(), mono.begin() + consumed);
+}
+
+double AudioResampler::nsPer10ms() const
+{
+	double buffers = totalFrames / (inputRate / 100.0);
+	return buffers > 0.0 ? totalNs / buffers : 0.0;
+}
+
+const char *AudioResampler::kernelName()
+{
+	return kernels().name;
+}
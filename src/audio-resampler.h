@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Converts OBS audio into what speech recognizers take: 16 kHz mono PCM16.
+//
+// OBS hands capture callbacks planar float at the output rate, usually
+// 48 or 44.1 kHz. Channels are averaged, then resampled by the rational
+// ratio of the two rates (1/3 from 48 kHz, 160/441 from 44.1 kHz) with a
+// polyphase FIR that only evaluates the outputs it keeps, and converted to
+// int16 with saturation. Each stage has SSE2, AVX2 and NEON kernels with a
+// scalar fallback; the widest one the CPU supports is picked once at
+// startup, keeping the cost to a few microseconds per buffer.
+class AudioResampler {
+public:
+	static constexpr uint32_t TARGET_RATE = 16000;
+
+	AudioResampler();
+
+	// Drops the filter history
+	void configure(uint32_t inputRate, uint32_t channels);
+	void reset();
+
+	uint32_t outputRate() const;
+
+	// Appends the converted samples to out; null planes count as silence
+	void process(const float *const *planes, uint32_t frames, bool muted, std::vector<int16_t> &out);
+	// Same for audio that was already downmixed
+	void processMono(const float *samples, size_t frames, std::vector<int16_t> &out);
+
+	// The downmix stage on its own, cheap enough for the OBS audio thread
+	static void downmix(const float *const *planes, uint32_t channels, size_t frames, float *out);
+
+	// Average time spent converting 10 ms of input so far
+	double nsPer10ms() const;
+
+	// Name of the kernel set in use, e.g. "AVX2"; the first call picks it
+	static const char *kernelName();
+
+private:
+	// Decimates and converts what has accumulated in mono
+	void convert(std::vector<int16_t> &out);
+
+	uint32_t inputRate;
+	uint32_t channels;
+	// Output rate is inputRate * up / down; 1/1 passes audio through
+	uint32_t up;
+	uint32_t down;
+	// up phases of phaseSize taps each, reversed for a dot product and zero-padded to a multiple of 8
+	std::vector<float> taps;
+	size_t phaseSize;
+	uint64_t position; // Next output, in input samples times up from the start of mono
+	std::vector<float> mono; // Filter history followed by the newest downmixed samples
+	std::vector<float> filtered;
+	uint64_t totalNs;
+	uint64_t totalFrames;
+};
@@ -0,0 +1,87 @@
+#include "audio-ring.h"
+#include "audio-resampler.h"
+
+#include <algorithm>
+#include <chrono>
+
+// Capture buffers carry at most this many planes (MAX_AV_PLANES)
+static const uint32_t MAX_PLANES = 8;
+
+AudioRing::AudioRing() : slots(new Slot[SLOT_COUNT]), head(0), tail(0), dropped(0), pushNs(0), pushFrames(0) {}
+
+void AudioRing::push(const float *const *planes, uint32_t channels, uint32_t frames, bool muted)
+{
+	auto start = std::chrono::steady_clock::now();
+	channels = std::min(channels, MAX_PLANES);
+
+	for (uint32_t offset = 0; offset < frames; offset += (uint32_t)SLOT_FRAMES) {
+		uint32_t count = std::min(frames - offset, (uint32_t)SLOT_FRAMES);
+
+		uint64_t h = head.load(std::memory_order_relaxed);
+		uint64_t t = tail.load();
+		if (h - t >= SLOT_COUNT) {
+			// Full: give up the oldest slot; if this fails the consumer has just taken it
+			if (tail.compare_exchange_strong(t, t + 1)) {
+				dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		Slot &slot = slots[h % SLOT_COUNT];
+		if (slot.busy.load()) {
+			// The consumer is still copying the slot this would overwrite
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+
+		if (muted) {
+			std::fill(slot.samples, slot.samples + count, 0.0f);
+		} else {
+			const float *chunk[MAX_PLANES] = {};
+			for (uint32_t c = 0; c < channels; c++) {
+				chunk[c] = planes[c] ? planes[c] + offset : nullptr;
+			}
+			AudioResampler::downmix(chunk, channels, count, slot.samples);
+		}
+		slot.frames = count;
+		head.store(h + 1);
+	}
+
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	pushNs.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+			 std::memory_order_relaxed);
+	pushFrames.fetch_add(frames, std::memory_order_relaxed);
+}
+
+bool AudioRing::pop(std::vector<float> &out)
+{
+	for (;;) {
+		uint64_t t = tail.load();
+		if (t == head.load()) {
+			return false;
+		}
+
+		// Claim the slot before taking it, so the producer cannot start overwriting it
+		Slot &slot = slots[t % SLOT_COUNT];
+		slot.busy.store(true);
+		if (tail.compare_exchange_strong(t, t + 1)) {
+			out.insert(out.end(), slot.samples, slot.samples + slot.frames);
+			slot.busy.store(false);
+			return true;
+		}
+		// The producer discarded it in the meantime; try the next one
+		slot.busy.store(false);
+	}
+}
+
+void AudioRing::reset()
+{
+	tail.store(head.load());
+	pushNs.store(0, std::memory_order_relaxed);
+	pushFrames.store(0, std::memory_order_relaxed);
+}
+
+double AudioRing::pushNsPer10ms(uint32_t sampleRate) const
+{
+	double buffers = pushFrames.load(std::memory_order_relaxed) / (sampleRate / 100.0);
+	return buffers > 0.0 ? pushNs.load(std::memory_order_relaxed) / buffers : 0.0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Hands captured audio from the OBS audio thread to the network thread.
+//
+// A single-producer, single-consumer ring of preallocated slots, each
+// holding up to one capture buffer of audio downmixed to mono. push() is
+// wait-free: it never blocks, allocates or loops, so a slow network thread
+// cannot glitch OBS's audio. When the consumer falls behind, the producer
+// discards the oldest unread slot instead of waiting for room. The consumer
+// marks the slot it is copying out of as busy; should the producer lap
+// around to that very slot, it skips the incoming buffer rather than
+// overwrite it. Both cases count as overruns.
+class AudioRing {
+public:
+	// OBS delivers AUDIO_OUTPUT_FRAMES (1024) frames per callback; longer buffers take several slots
+	static constexpr size_t SLOT_FRAMES = 1024;
+	// About 1.4 s at 48 kHz
+	static constexpr size_t SLOT_COUNT = 64;
+
+	AudioRing();
+
+	AudioRing(const AudioRing &) = delete;
+	AudioRing &operator=(const AudioRing &) = delete;
+
+	// Producer side: downmixes and stores one capture buffer
+	void push(const float *const *planes, uint32_t channels, uint32_t frames, bool muted);
+
+	// Consumer side: appends the oldest unread slot to out, false once empty
+	bool pop(std::vector<float> &out);
+
+	// Empties the ring; only while no producer is running
+	void reset();
+
+	uint64_t overruns() const { return dropped.load(std::memory_order_relaxed); }
+	// Average time push() took per 10 ms of audio at the given rate
+	double pushNsPer10ms(uint32_t sampleRate) const;
+
+private:
+	struct Slot {
+		std::atomic<bool> busy{false};
+		uint32_t frames = 0;
+		float samples[SLOT_FRAMES];
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	std::atomic<uint64_t> head; // Next sequence number to write; only the producer stores it
+	std::atomic<uint64_t> tail; // Oldest unread sequence number; advanced by either side
+	std::atomic<uint64_t> dropped;
+	std::atomic<uint64_t> pushNs;
+	std::atomic<uint64_t> pushFrames;
+};
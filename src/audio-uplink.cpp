@@ -0,0 +1,410 @@
+#include "audio-uplink.h"
+#include <obs-module.h>
+#include "plugin-support.h"
+
+#include <algorithm>
+
+// Non-speech frames kept back and sent ahead of a speech onset
+static const size_t PRE_ROLL_FRAMES = 3;
+
+// How often the backend thread drains the rings; well inside their 1.4 s capacity
+static const int POLL_INTERVAL_MS = 10;
+
+AudioUplink::AudioUplink(PipelineMetrics &metrics)
+	: metrics(metrics),
+	  backend(nullptr),
+	  frameMs(DEFAULT_FRAME_MS),
+	  framesPerMessage(DEFAULT_FRAMES_PER_MESSAGE),
+	  encoding(AudioEncoder::Format::Pcm),
+	  voiceGating(false),
+	  hangoverMs(VoiceActivityDetector::DEFAULT_HANGOVER_MS)
+{
+}
+
+AudioUplink::~AudioUplink()
+{
+	for (auto &stream : streams) {
+		detach(*stream);
+	}
+}
+
+void AudioUplink::setSources(const std::vector<Source> &sources)
+{
+	std::vector<std::unique_ptr<Stream>> current;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current.swap(streams);
+	}
+
+	// Untagged sources go by their name
+	std::vector<Source> wanted;
+	for (const Source &source : sources) {
+		if (!source.name.empty()) {
+			wanted.push_back({source.name, source.tag.empty() ? source.name : source.tag});
+		}
+	}
+	auto tapped = [](const std::vector<std::unique_ptr<Stream>> &list, const std::string &name) {
+		return std::any_of(list.begin(), list.end(),
+				   [&](const std::unique_ptr<Stream> &s) { return s->name == name; });
+	};
+	auto idTaken = [](const std::vector<std::unique_ptr<Stream>> &list, size_t id) {
+		return std::any_of(list.begin(), list.end(),
+				   [&](const std::unique_ptr<Stream> &s) { return s->id == id; });
+	};
+
+	// Streams whose source and tag are unchanged carry on without a restart
+	std::vector<std::unique_ptr<Stream>> kept;
+	std::vector<std::unique_ptr<Stream>> removed;
+	for (auto &stream : current) {
+		bool keep = !tapped(kept, stream->name) &&
+			    std::any_of(wanted.begin(), wanted.end(), [&](const Source &source) {
+				    return source.name == stream->name && source.tag == stream->tag;
+			    });
+		(keep ? kept : removed).push_back(std::move(stream));
+	}
+	for (auto &stream : removed) {
+		detach(*stream);
+	}
+
+	std::vector<std::unique_ptr<Stream>> added;
+	for (const Source &source : wanted) {
+		if (tapped(kept, source.name) || tapped(added, source.name)) {
+			continue;
+		}
+		if (kept.size() + added.size() >= MAX_STREAMS) {
+			obs_log(LOG_WARNING, "[Entei] Audio uplink is limited to %zu sources", MAX_STREAMS);
+			break;
+		}
+
+		// Lowest stream id not in use
+		size_t id = 0;
+		while (idTaken(kept, id) || idTaken(added, id)) {
+			id++;
+		}
+
+		std::unique_ptr<Stream> stream = std::make_unique<Stream>();
+		stream->name = source.name;
+		stream->tag = source.tag;
+		stream->id = (uint8_t)id;
+		if (attach(*stream)) {
+			added.push_back(std::move(stream));
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	streams = std::move(kept);
+	for (auto &stream : added) {
+		stream->restartPending = true;
+		streams.push_back(std::move(stream));
+	}
+	for (auto &stream : removed) {
+		if (backend && stream->streaming) {
+			retired.push_back(std::move(stream));
+		}
+	}
+}
+
+void AudioUplink::setFraming(int newFrameMs, int newFramesPerMessage)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (newFrameMs == frameMs && newFramesPerMessage == framesPerMessage) {
+		return;
+	}
+	frameMs = std::max(newFrameMs, 1);
+	framesPerMessage = std::max(newFramesPerMessage, 1);
+	restartAll();
+}
+
+void AudioUplink::setVoiceGating(bool enabled, int newHangoverMs)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (enabled == voiceGating && newHangoverMs == hangoverMs) {
+		return;
+	}
+	voiceGating = enabled;
+	hangoverMs = newHangoverMs;
+	restartAll();
+}
+
+void AudioUplink::setEncoding(AudioEncoder::Format format)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (format == encoding) {
+		return;
+	}
+	encoding = format;
+	restartAll();
+}
+
+void AudioUplink::setBackend(TranscriptionBackend *newBackend)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (newBackend == backend) {
+		return;
+	}
+	if (backend) {
+		backend->setTimer(nullptr, nullptr, 0);
+	}
+	backend = newBackend;
+
+	// A new connection starts every stream from scratch and has nothing to stop
+	retired.clear();
+	for (auto &stream : streams) {
+		stream->streaming = false;
+		stream->restartPending = true;
+		stream->overrunBaseline = stream->ring.overruns();
+	}
+	if (backend) {
+		backend->setTimer(poll_task, this, POLL_INTERVAL_MS);
+	}
+}
+
+bool AudioUplink::active() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return !streams.empty();
+}
+
+AudioUplink::Stats AudioUplink::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Stats result = counters;
+	result.streams = streams.size();
+	for (const auto &stream : streams) {
+		result.overruns += stream->ring.overruns() - stream->overrunBaseline;
+		result.tapNsPer10ms += stream->inputRate > 0 ? stream->ring.pushNsPer10ms(stream->inputRate) : 0.0;
+		result.convertNsPer10ms += stream->resampler.nsPer10ms();
+		result.vadNsPer10ms += voiceGating ? stream->vad.nsPer10ms() : 0.0;
+	}
+	return result;
+}
+
+void AudioUplink::restartAll()
+{
+	for (auto &stream : streams) {
+		stream->restartPending = true;
+	}
+}
+
+bool AudioUplink::attach(Stream &stream)
+{
+	obs_source_t *source = obs_get_source_by_name(stream.name.c_str());
+	if (!source) {
+		obs_log(LOG_WARNING, "[Entei] Audio source \"%s\" not found", stream.name.c_str());
+		return false;
+	}
+	if ((obs_source_get_output_flags(source) & OBS_SOURCE_AUDIO) == 0) {
+		obs_log(LOG_WARNING, "[Entei] Source \"%s\" has no audio", stream.name.c_str());
+		obs_source_release(source);
+		return false;
+	}
+
+	audio_t *audio = obs_get_audio();
+	stream.inputRate = audio_output_get_sample_rate(audio);
+	stream.channels.store((uint32_t)audio_output_get_channels(audio));
+
+	obs_log(LOG_INFO, "[Entei] Streaming audio from \"%s\" as stream %u \"%s\" (%u Hz, %u channel(s))",
+		stream.name.c_str(), (unsigned)stream.id, stream.tag.c_str(), stream.inputRate,
+		stream.channels.load());
+	// Also picks the SIMD kernels before the audio thread first needs them
+	obs_log(LOG_INFO, "[Entei] Audio resampler kernels: %s", AudioResampler::kernelName());
+
+	stream.weakSource = obs_source_get_weak_source(source);
+	obs_source_add_audio_capture_callback(source, audio_capture_callback, &stream);
+	obs_source_release(source);
+	return true;
+}
+
+void AudioUplink::detach(Stream &stream)
+{
+	if (!stream.weakSource) {
+		return;
+	}
+
+	// Removal waits for a callback in progress
+	obs_source_t *source = obs_weak_source_get_source(stream.weakSource);
+	if (source) {
+		obs_source_remove_audio_capture_callback(source, audio_capture_callback, &stream);
+		obs_source_release(source);
+	}
+	obs_weak_source_release(stream.weakSource);
+	stream.weakSource = nullptr;
+}
+
+void AudioUplink::audio_capture_callback(void *param, obs_source_t *source, const struct audio_data *audio,
+					 bool muted)
+{
+	UNUSED_PARAMETER(source);
+	Stream *stream = static_cast<Stream *>(param);
+
+	// Muted audio is sent as silence so the server's clock keeps running,
+	// unless voice gating holds it back like any other silence
+	const float *planes[MAX_AV_PLANES];
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		planes[c] = reinterpret_cast<const float *>(audio->data[c]);
+	}
+	stream->ring.push(planes, stream->channels.load(std::memory_order_relaxed), audio->frames, muted);
+}
+
+void AudioUplink::poll_task(void *param)
+{
+	static_cast<AudioUplink *>(param)->poll();
+}
+
+void AudioUplink::poll()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!backend) {
+		return;
+	}
+
+	for (auto &stream : retired) {
+		finishUtterance(*stream);
+		backend->stopAudio(stream->id);
+	}
+	retired.clear();
+
+	for (auto &stream : streams) {
+		pollStream(*stream);
+	}
+}
+
+void AudioUplink::pollStream(Stream &stream)
+{
+	if (stream.restartPending) {
+		restartStream(stream);
+	}
+
+	while (stream.ring.pop(stream.captured)) {
+	}
+	if (!stream.streaming || stream.captured.empty()) {
+		stream.captured.clear();
+		return;
+	}
+
+	stream.resampler.processMono(stream.captured.data(), stream.captured.size(), stream.pending);
+	stream.captured.clear();
+
+	size_t frame = frameSamples(stream);
+	size_t offset = 0;
+	while (frame > 0 && stream.pending.size() - offset >= frame) {
+		gateFrame(stream, stream.pending.data() + offset, frame);
+		offset += frame;
+	}
+	stream.pending.erase(stream.pending.begin(), stream.pending.begin() + offset);
+}
+
+void AudioUplink::restartStream(Stream &stream)
+{
+	finishUtterance(stream);
+	stream.restartPending = false;
+
+	// Audio captured before the restart belongs to the old settings or a previous connection
+	while (stream.ring.pop(stream.captured)) {
+	}
+	stream.captured.clear();
+	stream.pending.clear();
+	stream.outgoing.clear();
+	stream.preRoll.clear();
+
+	stream.resampler.configure(stream.inputRate, 1);
+	stream.sampleRate = stream.resampler.outputRate();
+	stream.vad.configure(stream.sampleRate, frameMs, hangoverMs);
+	// In-process backends take PCM only
+	bool opus = encoding == AudioEncoder::Format::Opus && backend->acceptsOpus();
+	stream.encoder.configure(opus ? encoding : AudioEncoder::Format::Pcm, stream.sampleRate, frameMs);
+
+	TranscriptionBackend::AudioFormat format;
+	format.stream = stream.id;
+	format.source = stream.tag;
+	format.encoding = AudioEncoder::formatName(stream.encoder.format());
+	if (stream.encoder.format() == AudioEncoder::Format::Opus) {
+		format.packetMs = stream.encoder.packetMs();
+		format.bitrate = AudioEncoder::OPUS_BITRATE;
+	}
+	format.sampleRate = stream.sampleRate;
+	format.frameMs = frameMs;
+	format.framesPerMessage = framesPerMessage;
+	format.voiceGating = voiceGating;
+	backend->startAudio(format);
+	stream.streaming = true;
+}
+
+void AudioUplink::finishUtterance(Stream &stream)
+{
+	// Close an utterance in progress so the server does not wait for its end
+	if (stream.streaming && stream.vad.speaking()) {
+		sendBatches(stream, true);
+		counters.speechSegments++;
+		backend->markSpeech(stream.id, false);
+	}
+	stream.vad.reset();
+}
+
+size_t AudioUplink::frameSamples(const Stream &stream) const
+{
+	return (size_t)stream.sampleRate * (size_t)frameMs / 1000;
+}
+
+void AudioUplink::gateFrame(Stream &stream, const int16_t *samples, size_t count)
+{
+	if (!voiceGating) {
+		stream.outgoing.insert(stream.outgoing.end(), samples, samples + count);
+		sendBatches(stream, false);
+		return;
+	}
+
+	bool wasSpeaking = stream.vad.speaking();
+	bool speaking = stream.vad.process(samples, count);
+
+	if (speaking) {
+		if (!wasSpeaking) {
+			backend->markSpeech(stream.id, true);
+			stream.outgoing.insert(stream.outgoing.end(), stream.preRoll.begin(), stream.preRoll.end());
+			stream.preRoll.clear();
+		}
+		stream.outgoing.insert(stream.outgoing.end(), samples, samples + count);
+		sendBatches(stream, false);
+		return;
+	}
+
+	if (wasSpeaking) {
+		// The utterance ended with the hangover; send its tail without waiting for a full message
+		sendBatches(stream, true);
+		counters.speechSegments++;
+		backend->markSpeech(stream.id, false);
+	}
+
+	stream.preRoll.insert(stream.preRoll.end(), samples, samples + count);
+	if (stream.preRoll.size() > count * PRE_ROLL_FRAMES) {
+		stream.preRoll.erase(stream.preRoll.begin(), stream.preRoll.begin() + count);
+		counters.framesSuppressed++;
+		counters.bytesSaved += count * sizeof(int16_t);
+	}
+}
+
+void AudioUplink::sendBatches(Stream &stream, bool flush)
+{
+	std::vector<int16_t> &outgoing = stream.outgoing;
+	size_t batch = frameSamples(stream) * (size_t)framesPerMessage;
+	size_t offset = 0;
+	while (batch > 0 && offset < outgoing.size()) {
+		size_t size = std::min(batch, outgoing.size() - offset);
+		if (size < batch && !flush) {
+			break;
+		}
+		payload.clear();
+		if (stream.encoder.encode(outgoing.data() + offset, size, payload) &&
+		    backend->sendAudio(stream.id, payload.data(), payload.size())) {
+			counters.messagesSent++;
+			counters.bytesSent += payload.size();
+			counters.pcmBytesSent += size * sizeof(int16_t);
+			metrics.add(PipelineMetrics::BytesOut, payload.size());
+		} else {
+			counters.messagesDropped++;
+			metrics.add(PipelineMetrics::AudioDropped);
+		}
+		offset += size;
+	}
+	outgoing.erase(outgoing.begin(), outgoing.begin() + offset);
+}
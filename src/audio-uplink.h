@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "audio-encoder.h"
+#include "audio-resampler.h"
+#include "audio-ring.h"
+#include "audio-vad.h"
+#include "pipeline-metrics.h"
+#include "transcription-backend.h"
+
+struct obs_source;
+struct obs_weak_source;
+struct audio_data;
+
+// Streams OBS audio sources to the primary track's TranscriptionBackend, so
+// no separate capture has to feed the transcriber.
+//
+// Each source is tapped with an audio capture callback and becomes its own
+// stream, identified by a one-byte stream id and a tag such as "host" or
+// "guest". Streams are never mixed: every one has its own resampler, voice
+// activity detector and encoder, so the transcriber can tell and attribute
+// each speaker separately and cost grows linearly with the source count.
+//
+// Audio is converted to 16 kHz mono 16-bit PCM by AudioResampler and sent in
+// payloads of framesPerMessage frames of frameMs each, Opus-encoded if the
+// backend takes it. Smaller batches cut latency, larger ones cut per-payload
+// overhead. Each stream is announced with its id, tag and format before its
+// first payload.
+//
+// With voice gating on, only frames the VoiceActivityDetector takes for
+// speech are sent, bracketed by speech start and end markers. A
+// few frames from before the onset go out with the first batch so the
+// first syllable is not clipped.
+//
+// The capture callbacks run on OBS's real-time audio thread, so they only
+// downmix into a wait-free AudioRing per stream: no locks, no allocation. A
+// timer on a backend thread drains the rings and does everything else, from
+// resampling to encoding and sending.
+class AudioUplink {
+public:
+	struct Source {
+		std::string name; // OBS source
+		std::string tag;  // Label the transcriber attaches to the stream's segments
+	};
+
+	struct Stats {
+		uint64_t streams = 0;
+		uint64_t messagesSent = 0;
+		uint64_t bytesSent = 0;
+		uint64_t messagesDropped = 0;  // Payloads the backend did not take
+		uint64_t overruns = 0;         // Capture buffers lost because the backend thread fell behind
+		uint64_t framesSuppressed = 0; // Non-speech frames held back by voice gating
+		uint64_t bytesSaved = 0;
+		uint64_t speechSegments = 0;
+		uint64_t pcmBytesSent = 0;     // What the sent audio would have taken as PCM
+		double tapNsPer10ms = 0.0;     // Capture callback cost on the OBS audio thread, all streams
+		double convertNsPer10ms = 0.0; // Resampling cost on the backend thread, all streams
+		double vadNsPer10ms = 0.0;     // Voice activity detection cost on the backend thread, all streams
+	};
+
+	explicit AudioUplink(PipelineMetrics &metrics);
+	// The backends' threads must be stopped first, as their timers call into the uplink
+	~AudioUplink();
+
+	AudioUplink(const AudioUplink &) = delete;
+	AudioUplink &operator=(const AudioUplink &) = delete;
+
+	// Taps these sources; streams for sources already tapped carry on. An empty list stops the uplink.
+	void setSources(const std::vector<Source> &sources);
+	void setFraming(int frameMs, int framesPerMessage);
+	void setVoiceGating(bool enabled, int hangoverMs);
+	void setEncoding(AudioEncoder::Format format);
+	// Backend to stream to, or nullptr; must be cleared before the backend is destroyed
+	void setBackend(TranscriptionBackend *backend);
+
+	bool active() const;
+	Stats stats() const;
+
+	static constexpr int DEFAULT_FRAME_MS = 20;
+	static constexpr int DEFAULT_FRAMES_PER_MESSAGE = 2;
+	// Stream ids are a single byte
+	static constexpr size_t MAX_STREAMS = 256;
+
+private:
+	// One tapped source, from its capture ring to its encoder
+	struct Stream {
+		std::string name;
+		std::string tag;
+		uint8_t id = 0;
+		struct obs_weak_source *weakSource = nullptr; // Only touched from the UI thread
+
+		// Filled by the OBS audio thread, drained by the backend thread
+		AudioRing ring;
+		std::atomic<uint32_t> channels{0};
+
+		// Guarded by the uplink mutex
+		uint32_t inputRate = 0;
+		uint64_t overrunBaseline = 0;
+		bool restartPending = false;
+		bool streaming = false;
+		uint32_t sampleRate = 0; // Rate sent to the backend
+		AudioResampler resampler;
+		VoiceActivityDetector vad;
+		AudioEncoder encoder;
+		std::vector<float> captured;   // Mono audio taken out of the ring
+		std::vector<int16_t> pending;  // Resampled audio not yet split into frames
+		std::vector<int16_t> outgoing; // Frames waiting to fill a message
+		std::vector<int16_t> preRoll;  // Latest non-speech frames, sent if speech starts
+	};
+
+	static void audio_capture_callback(void *param, struct obs_source *source, const struct audio_data *audio,
+					   bool muted);
+	static void poll_task(void *param);
+	void poll();
+	bool attach(Stream &stream);
+	static void detach(Stream &stream);
+	void restartAll();
+	void pollStream(Stream &stream);
+	void restartStream(Stream &stream);
+	void finishUtterance(Stream &stream);
+	void gateFrame(Stream &stream, const int16_t *samples, size_t count);
+	void sendBatches(Stream &stream, bool flush);
+	size_t frameSamples(const Stream &stream) const;
+
+	PipelineMetrics &metrics;
+
+	// Everything below is guarded by the mutex, which the audio thread never takes
+	mutable std::mutex mutex;
+	TranscriptionBackend *backend;
+	std::vector<std::unique_ptr<Stream>> streams;
+	// Untapped streams whose end the backend thread still has to announce
+	std::vector<std::unique_ptr<Stream>> retired;
+
+	// Settings from the UI thread; the backend thread applies them by restarting the streams
+	int frameMs;
+	int framesPerMessage;
+	AudioEncoder::Format encoding;
+	bool voiceGating;
+	int hangoverMs;
+
+	std::vector<uint8_t> payload;
+	Stats counters;
+};
@@ -0,0 +1,106 @@
+#include "audio-vad.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Frames this far above the noise floor are speech
+static const double SPEECH_MARGIN_DB = 10.0;
+// Quieter frames still count when they cross zero as often as a fricative does
+static const double FRICATIVE_MARGIN_DB = 5.0;
+static const double FRICATIVE_CROSSING_RATE = 0.3;
+// Anything quieter is never speech, however still the room is
+static const double MIN_SPEECH_DB = -50.0;
+// Keeps digital silence from pulling the floor so low that hiss looks like speech
+static const double MIN_FLOOR_DB = -70.0;
+
+// The floor drops quickly to quieter frames but rises slowly, and slower
+// still during speech, so it follows a room that gets noisier without
+// learning the voice itself
+static const double FLOOR_FALL_RATE = 0.5;
+static const double FLOOR_RISE_RATE = 0.05;
+static const double FLOOR_RISE_RATE_SPEECH = 0.002;
+
+VoiceActivityDetector::VoiceActivityDetector()
+	: sampleRate(16000),
+	  hangoverFrames(0),
+	  noiseFloorDb(MIN_FLOOR_DB),
+	  floorKnown(false),
+	  inSpeech(false),
+	  silentFrames(0),
+	  totalNs(0),
+	  totalSamples(0)
+{
+	configure(sampleRate, 20, DEFAULT_HANGOVER_MS);
+}
+
+void VoiceActivityDetector::configure(uint32_t rate, int frameMs, int hangoverMs)
+{
+	sampleRate = rate > 0 ? rate : 16000;
+	frameMs = std::max(frameMs, 1);
+	hangoverFrames = (std::max(hangoverMs, 0) + frameMs - 1) / frameMs;
+	reset();
+}
+
+void VoiceActivityDetector::reset()
+{
+	noiseFloorDb = MIN_FLOOR_DB;
+	floorKnown = false;
+	inSpeech = false;
+	silentFrames = 0;
+	totalNs = 0;
+	totalSamples = 0;
+}
+
+bool VoiceActivityDetector::process(const int16_t *samples, size_t count)
+{
+	if (count == 0) {
+		return inSpeech;
+	}
+	auto start = std::chrono::steady_clock::now();
+
+	int64_t energy = 0;
+	size_t crossings = 0;
+	for (size_t i = 0; i < count; i++) {
+		energy += (int64_t)samples[i] * samples[i];
+	}
+	for (size_t i = 1; i < count; i++) {
+		crossings += (samples[i] < 0) != (samples[i - 1] < 0);
+	}
+
+	double meanSquare = (double)energy / count / (32768.0 * 32768.0);
+	double levelDb = 10.0 * std::log10(meanSquare + 1e-12);
+	double crossingRate = (double)crossings / count;
+
+	if (!floorKnown) {
+		noiseFloorDb = std::max(levelDb, MIN_FLOOR_DB);
+		floorKnown = true;
+	}
+
+	double margin = levelDb - noiseFloorDb;
+	bool voiced = margin > SPEECH_MARGIN_DB;
+	bool fricative = margin > FRICATIVE_MARGIN_DB && crossingRate > FRICATIVE_CROSSING_RATE;
+	bool speech = levelDb > MIN_SPEECH_DB && (voiced || fricative);
+
+	double rate = levelDb < noiseFloorDb ? FLOOR_FALL_RATE : speech ? FLOOR_RISE_RATE_SPEECH : FLOOR_RISE_RATE;
+	noiseFloorDb = std::max(noiseFloorDb + (levelDb - noiseFloorDb) * rate, MIN_FLOOR_DB);
+
+	if (speech) {
+		inSpeech = true;
+		silentFrames = 0;
+	} else if (inSpeech && ++silentFrames > hangoverFrames) {
+		inSpeech = false;
+		silentFrames = 0;
+	}
+
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	totalNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	totalSamples += count;
+	return inSpeech;
+}
+
+double VoiceActivityDetector::nsPer10ms() const
+{
+	double frames = totalSamples / (sampleRate / 100.0);
+	return frames > 0.0 ? totalNs / frames : 0.0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Decides which uplink frames carry speech, so silence is not streamed to the
+// transcriber where it costs bandwidth and GPU time and tends to come back as
+// empty or hallucinated segments.
+//
+// A frame counts as speech when its energy stands well above an adaptive
+// noise floor, or somewhat above it with the high zero-crossing rate of a
+// fricative ("s", "f") that energy alone would miss. Speech then holds for a
+// hangover period so pauses between words do not split an utterance.
+class VoiceActivityDetector {
+public:
+	static constexpr int DEFAULT_HANGOVER_MS = 300;
+
+	VoiceActivityDetector();
+
+	void configure(uint32_t sampleRate, int frameMs, int hangoverMs);
+	// Forgets the noise floor and any speech in progress
+	void reset();
+
+	// Classifies one frame; true while speech is in progress, hangover included
+	bool process(const int16_t *samples, size_t count);
+	bool speaking() const { return inSpeech; }
+
+	// Average time spent classifying 10 ms of audio so far
+	double nsPer10ms() const;
+
+private:
+	uint32_t sampleRate;
+	int hangoverFrames;
+	double noiseFloorDb;
+	bool floorKnown;
+	bool inSpeech;
+	int silentFrames;
+	uint64_t totalNs;
+	uint64_t totalSamples;
+};
@@ -0,0 +1,239 @@
+#include "caption-charset.h"
+#include "cea708-tables.h"
+#include "utf8.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CHARSET_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CHARSET_NEON
+#endif
+
+using cea708::CHARS_608;
+
+namespace {
+
+// What a code point turns into: the source character itself, or up to three
+// bytes of replacement text (none drops it)
+struct Fold {
+	uint8_t size;
+	char text[3];
+};
+
+constexpr uint8_t KEEP = 0xFF;
+
+constexpr Fold make_fold(const char *text)
+{
+	Fold fold{};
+	while (fold.size < sizeof(fold.text) && text[fold.size]) {
+		fold.text[fold.size] = text[fold.size];
+		fold.size++;
+	}
+	return fold;
+}
+
+struct Replacement {
+	uint32_t codepoint;
+	const char *text;
+};
+
+// Nearest spelling for characters the 608 set lacks, sorted by code point
+constexpr Replacement REPLACEMENTS[] = {
+	{0x00A0, " "},   {0x00A6, "|"},   {0x00AA, "a"},   {0x00AC, "-"},    {0x00AF, "-"},    {0x00B1, "+/-"},
+	{0x00B2, "2"},   {0x00B3, "3"},   {0x00B4, "'"},   {0x00B5, "u"},    {0x00B7, "."},    {0x00B8, ","},
+	{0x00B9, "1"},   {0x00BA, "o"},   {0x00BC, "1/4"}, {0x00BE, "3/4"},  {0x00C6, "AE"},   {0x00D0, "D"},
+	{0x00D7, "x"},   {0x00DD, "Y"},   {0x00DE, "TH"},  {0x00E6, "ae"},   {0x00F0, "d"},    {0x00FD, "y"},
+	{0x00FE, "th"},  {0x00FF, "y"},   {0x0132, "IJ"},  {0x0133, "ij"},   {0x0152, "OE"},   {0x0153, "oe"},
+	{0x0192, "f"},   {0x0218, "S"},   {0x0219, "s"},   {0x021A, "T"},    {0x021B, "t"},    {0x02B9, "'"},
+	{0x02BA, "\""},  {0x02BB, "'"},   {0x02BC, "'"},   {0x02C6, "^"},    {0x02DC, "~"},    {0x2010, "-"},
+	{0x2011, "-"},   {0x2012, "-"},   {0x2013, "-"},   {0x2015, "-"},    {0x201A, "'"},    {0x201B, "'"},
+	{0x201E, "\""},  {0x201F, "\""},  {0x2020, "+"},   {0x2024, "."},    {0x2025, ".."},   {0x2026, "..."},
+	{0x202F, " "},   {0x2032, "'"},   {0x2033, "\""},  {0x2035, "'"},    {0x2039, "<"},    {0x203A, ">"},
+	{0x2044, "/"},   {0x204E, "*"},   {0x205F, " "},   {0x20AC, "EUR"},  {0x20B9, "Rs"},   {0x2116, "No"},
+	{0x2190, "<-"},  {0x2192, "->"},  {0x2194, "<->"}, {0x21D2, "=>"},   {0x2212, "-"},    {0x2215, "/"},
+	{0x2217, "*"},   {0x2219, "."},   {0x2248, "~"},   {0x2260, "!="},   {0x2264, "<="},   {0x2265, ">="},
+	{0x2500, "-"},   {0x2669, "♪"},   {0x266B, "♪"},   {0x266C, "♪"},    {0x3000, " "},
+};
+
+// Base letters for Latin Extended-A (U+0100-U+017F), in code point order
+constexpr char LATIN_EXTENDED_A[] = "AaAaAaCcCcCcCcDd"
+				    "DdEeEeEeEeEeGgGg"
+				    "GgGgHhHhIiIiIiIi"
+				    "IiIiJjKkkLlLlLlL"
+				    "lLlNnNnNnnNnOoOo"
+				    "OoOoRrRrRrSsSsSs"
+				    "SsTtTtTtUuUuUuUu"
+				    "UuUuWwYyYZzZzZzs";
+
+static_assert(sizeof(LATIN_EXTENDED_A) == 0x80 + 1, "one base letter per Latin Extended-A code point");
+
+// Direct lookup for U+0080-U+017F, where almost all accented Latin text lands
+constexpr uint32_t LATIN_FIRST = 0x80;
+constexpr uint32_t LATIN_END = 0x180;
+
+constexpr std::array<Fold, LATIN_END - LATIN_FIRST> make_latin_table()
+{
+	std::array<Fold, LATIN_END - LATIN_FIRST> table{};
+	for (uint32_t cp = 0x100; cp < LATIN_END; cp++) {
+		table[cp - LATIN_FIRST] = {1, {LATIN_EXTENDED_A[cp - 0x100], 0, 0}};
+	}
+	for (const Replacement &replacement : REPLACEMENTS) {
+		if (replacement.codepoint >= LATIN_FIRST && replacement.codepoint < LATIN_END) {
+			table[replacement.codepoint - LATIN_FIRST] = make_fold(replacement.text);
+		}
+	}
+	// Characters the 608 set carries win over any approximation
+	for (const cea708::Char608 &ch : CHARS_608) {
+		if (ch.codepoint >= LATIN_FIRST && ch.codepoint < LATIN_END) {
+			table[ch.codepoint - LATIN_FIRST] = {KEEP, {0, 0, 0}};
+		}
+	}
+	return table;
+}
+
+constexpr std::array<Fold, LATIN_END - LATIN_FIRST> LATIN = make_latin_table();
+
+template<size_t N> constexpr bool valid_replacements(const Replacement (&table)[N])
+{
+	for (size_t i = 0; i < N; i++) {
+		if (i > 0 && table[i - 1].codepoint >= table[i].codepoint) {
+			return false;
+		}
+		size_t length = 0;
+		while (table[i].text[length]) {
+			length++;
+		}
+		if (length == 0 || length > sizeof(Fold::text)) {
+			return false;
+		}
+		for (const cea708::Char608 &ch : CHARS_608) {
+			if (ch.codepoint == table[i].codepoint) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static_assert(valid_replacements(REPLACEMENTS), "REPLACEMENTS must be sorted, fit a Fold and not shadow CHARS_608");
+static_assert(LATIN[0xE9 - LATIN_FIRST].size == KEEP && LATIN[0x0141 - LATIN_FIRST].text[0] == 'L' &&
+		      LATIN[0x0152 - LATIN_FIRST].size == 2,
+	      "Latin fold table");
+
+Fold lookup(uint32_t cp)
+{
+	if (cp < LATIN_FIRST) {
+		return {KEEP, {0, 0, 0}};
+	}
+	if (cp < LATIN_END) {
+		return LATIN[cp - LATIN_FIRST];
+	}
+
+	auto kept = std::lower_bound(std::begin(CHARS_608), std::end(CHARS_608), cp,
+				     [](const cea708::Char608 &ch, uint32_t value) { return ch.codepoint < value; });
+	if (kept != std::end(CHARS_608) && kept->codepoint == cp) {
+		return {KEEP, {0, 0, 0}};
+	}
+
+	auto replacement =
+		std::lower_bound(std::begin(REPLACEMENTS), std::end(REPLACEMENTS), cp,
+				 [](const Replacement &entry, uint32_t value) { return entry.codepoint < value; });
+	if (replacement != std::end(REPLACEMENTS) && replacement->codepoint == cp) {
+		return make_fold(replacement->text);
+	}
+
+	if (cp >= 0x2000 && cp <= 0x200A) {
+		// Typographic spaces
+		return make_fold(" ");
+	}
+	if (cp >= 0xFF01 && cp <= 0xFF5E) {
+		// Fullwidth forms of ASCII
+		return {1, {(char)(cp - 0xFEE0), 0, 0}};
+	}
+
+	// Emoji, joiners, combining marks and scripts no caption decoder can draw
+	return {0, {0, 0, 0}};
+}
+
+} // namespace
+
+bool caption_charset_is_ascii(const char *text, size_t size)
+{
+	// OR every byte together; the high bit survives if any byte had it
+	size_t i = 0;
+#if defined(CHARSET_SSE2)
+	__m128i bits = _mm_setzero_si128();
+	for (; i + 16 <= size; i += 16) {
+		bits = _mm_or_si128(bits, _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i)));
+	}
+	if (_mm_movemask_epi8(bits) != 0) {
+		return false;
+	}
+#elif defined(CHARSET_NEON)
+	uint8x16_t bits = vdupq_n_u8(0);
+	for (; i + 16 <= size; i += 16) {
+		bits = vorrq_u8(bits, vld1q_u8(reinterpret_cast<const uint8_t *>(text + i)));
+	}
+	if (vmaxvq_u8(bits) >= 0x80) {
+		return false;
+	}
+#endif
+
+	uint64_t word = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t chunk;
+		memcpy(&chunk, text + i, sizeof(chunk));
+		word |= chunk;
+	}
+	for (; i < size; i++) {
+		word |= (uint8_t)text[i];
+	}
+	return (word & 0x8080808080808080ULL) == 0;
+}
+
+bool caption_charset_fold(const char *text, size_t size, std::string &out)
+{
+	if (caption_charset_is_ascii(text, size)) {
+		return false;
+	}
+
+	std::string folded;
+	bool changed = false;
+	const char *run = text; // Start of source bytes not yet copied
+	const char *p = text;
+	const char *end = text + size;
+
+	while (p < end) {
+		if ((uint8_t)*p < 0x80) {
+			p++;
+			continue;
+		}
+
+		const char *start = p;
+		Fold fold = lookup(utf8_next(p, end));
+		if (fold.size == KEEP) {
+			continue;
+		}
+
+		if (!changed) {
+			folded.reserve(size);
+			changed = true;
+		}
+		folded.append(run, start - run);
+		folded.append(fold.text, fold.size);
+		run = p;
+	}
+
+	if (!changed) {
+		return false;
+	}
+	folded.append(run, end - run);
+	out.swap(folded);
+	return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Folds transcriber output onto the characters CEA-608 decoders can draw.
+//
+// Curly quotes, dashes and accented letters the 608 set carries are kept;
+// anything else is replaced with its nearest ASCII spelling (ellipsis to
+// "...", "Æ" to "AE", "€" to "EUR") or dropped when there is none, as with
+// emoji and their modifiers. The 708 service gets the same text so both
+// tracks read alike.
+
+// True if text is plain ASCII and needs no folding
+bool caption_charset_is_ascii(const char *text, size_t size);
+
+// Writes the folded UTF-8 text to out. Returns false, leaving out untouched,
+// when text is already within the caption character set.
+bool caption_charset_fold(const char *text, size_t size, std::string &out);
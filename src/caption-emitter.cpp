@@ -0,0 +1,294 @@
+#include "caption-emitter.h"
+#include "caption-track.h"
+#include <obs-module.h>
+#include "plugin-support.h"
+
+#include <QtCore/QDateTime>
+
+#include <algorithm>
+
+// Roll-up depth used by the native encoder
+static const int CAPTION_ROLL_UP_ROWS = 3;
+
+CaptionEmitter::CaptionEmitter()
+	: running(false),
+	  enabled(false),
+	  nativeEncoder(false),
+	  changes(0),
+	  clearAt(0),
+	  loggedUnsupportedService(false)
+{
+}
+
+CaptionEmitter::~CaptionEmitter()
+{
+	stop();
+	clear();
+}
+
+void CaptionEmitter::start()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		updateFrameRate();
+	}
+	if (!running.exchange(true)) {
+		obs_add_tick_callback(tick_callback, this);
+	}
+}
+
+void CaptionEmitter::stop()
+{
+	// Must not hold the mutex: removal waits for a tick that may be waiting on it
+	if (running.exchange(false)) {
+		obs_remove_tick_callback(tick_callback, this);
+	}
+}
+
+void CaptionEmitter::setTracks(std::vector<CaptionTrack *> newTracks)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	tracks.swap(newTracks);
+	loggedUnsupportedService = false;
+}
+
+void CaptionEmitter::setEnabled(bool enable)
+{
+	enabled.store(enable);
+}
+
+void CaptionEmitter::setNativeEncoder(bool native)
+{
+	nativeEncoder.store(native);
+}
+
+void CaptionEmitter::setEmitHandler(EmitHandler handler)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	emitHandler = std::move(handler);
+}
+
+void CaptionEmitter::noteChanged()
+{
+	changes.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CaptionEmitter::outputStarted(bool preserveDelay)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	outputRegistry.markDirty();
+	outputRegistry.setPreserveDelay(preserveDelay);
+	// A new output starts with a blank decoder, so drop any window state
+	captionEncoder.reset();
+	updateFrameRate();
+}
+
+void CaptionEmitter::outputStopped()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	outputRegistry.markDirty();
+	if (!outputRegistry.refresh()) {
+		// Nothing left to caption
+		clearAt = 0;
+	}
+}
+
+void CaptionEmitter::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	outputRegistry.clear();
+	clearAt = 0;
+}
+
+std::vector<OutputRegistry::OutputStats> CaptionEmitter::outputStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return outputRegistry.stats();
+}
+
+CaptionPacer::Stats CaptionEmitter::pacerStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return captionPacer.stats(QDateTime::currentMSecsSinceEpoch());
+}
+
+double CaptionEmitter::frameRate() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return captionPacer.frameRate();
+}
+
+void CaptionEmitter::tick_callback(void *param, float seconds)
+{
+	UNUSED_PARAMETER(seconds);
+	static_cast<CaptionEmitter *>(param)->tick();
+}
+
+void CaptionEmitter::tick()
+{
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Captions held back for delayed outputs go out as their video catches up
+	outputRegistry.releaseDue();
+
+	if (clearAt > 0 && now >= clearAt) {
+		clearAt = 0;
+		clearCaptions(now);
+	}
+
+	uint64_t changed = changes.exchange(0, std::memory_order_relaxed);
+	if (changed > 0) {
+		captionPacer.merge(changed);
+	}
+
+	if (!enabled.load()) {
+		return;
+	}
+
+	// Due times are read without locking; a track's lock is only taken to send
+	bool due = std::any_of(tracks.begin(), tracks.end(),
+			       [now](const CaptionTrack *track) { return track->captionDue(now); });
+	if (!due) {
+		return;
+	}
+
+	// Only send captions while at least one output is running
+	if (!outputRegistry.refresh()) {
+		return;
+	}
+
+	// The channel is still busy with earlier captions; newer revisions replace
+	// the waiting one in the meantime instead of queueing behind it
+	if (captionPacer.delay(now) > 0) {
+		captionPacer.defer();
+		return;
+	}
+
+	emitCaptions(now);
+}
+
+void CaptionEmitter::emitCaptions(qint64 now)
+{
+	bool native = nativeEncoder.load();
+	bool emitted = false;
+	double longestDuration = 0.0;
+	for (CaptionTrack *track : tracks) {
+		CaptionPipeline::Caption caption;
+		if (!track->takeCaption(now, caption)) {
+			continue;
+		}
+		emitted = true;
+		longestDuration = std::max(longestDuration, caption.duration);
+		track->traceEmit(PipelineTracer::Begin);
+
+		if (native) {
+			encodeCaption(track, caption);
+			track->traceEmit(PipelineTracer::End);
+			if (track->shouldLogEmission(now)) {
+				obs_log(LOG_INFO, "[Entei] Encoding caption for service %d at %lld: %s",
+					track->service(), now, caption.text.left(50).constData());
+			}
+			continue;
+		}
+
+		// The caption text API only carries a single caption stream
+		if (track->service() != 1) {
+			if (!loggedUnsupportedService) {
+				obs_log(LOG_WARNING, "[Entei] Caption service %d needs the native CEA-708 encoder",
+					track->service());
+				loggedUnsupportedService = true;
+			}
+			track->traceEmit(PipelineTracer::End);
+			continue;
+		}
+
+		// The pipeline sizes the duration from the caption's length and the reading rate,
+		// bounded to 1-7 seconds and stretched to meet the next expected caption.
+		// The text API has no roll-up commands, so roll-up sends the scrolled window;
+		// it still only goes out when a line completes. Every output gets the same buffer.
+		outputRegistry.sendText(caption.text.constData(), caption.duration);
+		captionPacer.consumeText(caption.text.constData(), (size_t)caption.text.size(), now);
+		track->traceEmit(PipelineTracer::End);
+
+		// Debug: Log actual caption sends with timestamp
+		if (track->shouldLogEmission(now)) {
+			obs_log(LOG_INFO, "[Entei] Sending caption at %lld: %s", now,
+				caption.text.left(50).constData());
+		}
+	}
+
+	if (!emitted) {
+		return;
+	}
+
+	if (native) {
+		// All services share the same packets, so send once per tick and
+		// clear once the longest caption has been on screen long enough
+		sendEncodedCaptions(now);
+		clearAt = now + (qint64)(longestDuration * 1000.0);
+	}
+	if (emitHandler) {
+		emitHandler();
+	}
+}
+
+void CaptionEmitter::encodeCaption(const CaptionTrack *track, const CaptionPipeline::Caption &caption)
+{
+	int service = track->service();
+	if (caption.roll_up) {
+		// Roll-up only carries the lines completed since the last send
+		if (caption.appended.isEmpty()) {
+			return;
+		}
+		for (const QByteArray &line : caption.appended.split('\n')) {
+			std::string text = line.toStdString();
+			captionEncoder.rollUp708(service, text, CAPTION_ROLL_UP_ROWS);
+			if (service == 1) {
+				captionEncoder.rollUp608(text, CAPTION_ROLL_UP_ROWS);
+			}
+		}
+		return;
+	}
+
+	std::vector<std::string> lines;
+	for (const QByteArray &line : caption.text.split('\n')) {
+		lines.push_back(line.toStdString());
+	}
+	captionEncoder.popOn708(service, lines);
+	if (service == 1) {
+		captionEncoder.popOn608(lines);
+	}
+}
+
+void CaptionEmitter::sendEncodedCaptions(qint64 now)
+{
+	if (!captionEncoder.finish(ccData)) {
+		return;
+	}
+
+	outputRegistry.sendCaption(ccData.data(), ccData.size());
+	captionPacer.consumeCcData(ccData.data(), ccData.size(), now);
+}
+
+void CaptionEmitter::clearCaptions(qint64 now)
+{
+	if (!nativeEncoder.load() || !outputRegistry.refresh()) {
+		return;
+	}
+
+	captionEncoder.clear608();
+	for (const CaptionTrack *track : tracks) {
+		captionEncoder.clear708(track->service());
+	}
+	sendEncodedCaptions(now);
+}
+
+void CaptionEmitter::updateFrameRate()
+{
+	// Outputs lock the video settings while running, so this holds until they stop
+	struct obs_video_info ovi;
+	if (obs_get_video_info(&ovi) && ovi.fps_den > 0) {
+		captionPacer.setFrameRate((double)ovi.fps_num / ovi.fps_den);
+	}
+}
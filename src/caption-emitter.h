@@ -0,0 +1,84 @@
+#pragma once
+
+#include <QtCore/QtGlobal>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "caption-pacer.h"
+#include "caption-pipeline.h"
+#include "cea708-encoder.h"
+#include "output-registry.h"
+
+class CaptionTrack;
+
+// Sends composed captions to every active output from an OBS tick callback.
+//
+// The tick runs once per rendered frame on the graphics thread, so caption
+// timing follows the video rather than the Qt event loop: a modal dialog or
+// a scene collection load on the UI thread no longer holds captions back.
+// Each tick polls the tracks' lock-free due times and only takes a track's
+// lock when it actually has a caption to send. It also releases captions
+// waiting out a stream delay and clears native captions once they expire.
+//
+// The UI thread configures the emitter and reads its statistics; those calls
+// share a mutex with the tick but only hold it briefly.
+class CaptionEmitter {
+public:
+	typedef std::function<void()> EmitHandler;
+
+	CaptionEmitter();
+	~CaptionEmitter();
+
+	CaptionEmitter(const CaptionEmitter &) = delete;
+	CaptionEmitter &operator=(const CaptionEmitter &) = delete;
+
+	void start();
+	// Blocks until a tick in progress has finished
+	void stop();
+
+	// The tracks must outlive the emitter or be replaced before they are destroyed
+	void setTracks(std::vector<CaptionTrack *> tracks);
+	void setEnabled(bool enabled);
+	void setNativeEncoder(bool native);
+	// Called from the graphics thread after captions went out
+	void setEmitHandler(EmitHandler handler);
+	// Called from worker threads whenever a track's caption changes
+	void noteChanged();
+
+	void outputStarted(bool preserveDelay);
+	void outputStopped();
+	void clear();
+
+	std::vector<OutputRegistry::OutputStats> outputStats() const;
+	CaptionPacer::Stats pacerStats();
+	double frameRate() const;
+
+private:
+	static void tick_callback(void *param, float seconds);
+	void tick();
+	void emitCaptions(qint64 now);
+	void encodeCaption(const CaptionTrack *track, const CaptionPipeline::Caption &caption);
+	void sendEncodedCaptions(qint64 now);
+	void clearCaptions(qint64 now);
+	void updateFrameRate();
+
+	std::atomic<bool> running;
+	std::atomic<bool> enabled;
+	std::atomic<bool> nativeEncoder;
+	std::atomic<uint64_t> changes; // Updates since the last tick
+
+	// Everything below is guarded by the mutex
+	mutable std::mutex mutex;
+	std::vector<CaptionTrack *> tracks;
+	OutputRegistry outputRegistry;
+	CaptionEncoder captionEncoder;
+	std::vector<uint8_t> ccData;
+	CaptionPacer captionPacer;
+	qint64 clearAt; // When the native caption on screen expires, 0 if none
+	bool loggedUnsupportedService;
+	EmitHandler emitHandler;
+};
@@ -0,0 +1,156 @@
+#include "caption-pacer.h"
+#include "cea708-tables.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace cea708;
+
+// cc_data carries 9600 bit/s: 600 triplets a second whatever the frame rate
+static const double CC_TRIPLETS_PER_SECOND = 600.0;
+// CEA-608 runs at the NTSC field rate: one field 1 pair per frame, at most ~30 a second
+static const double MAX_608_PAIRS_PER_SECOND = 29.97;
+// Both 608 fields take their slots out of the total
+static const double DTVCC_TRIPLETS_PER_SECOND = CC_TRIPLETS_PER_SECOND - 2 * MAX_608_PAIRS_PER_SECOND;
+
+// An idle channel may take this much at once, so a lone caption goes out immediately
+static const double BURST_SECONDS = 0.5;
+
+static const double DEFAULT_FPS = 30.0;
+
+// Pairs libobs spends around each pop-on block: doubled RCL, ENM and EOC,
+// plus a doubled PAC per row
+static const size_t POP_ON_CONTROL_PAIRS = 6;
+static const size_t ROW_PREAMBLE_PAIRS = 2;
+
+CaptionPacer::CaptionPacer()
+	: fps(0.0),
+	  rate608(0.0),
+	  rateDtvcc(0.0),
+	  tokens608(0.0),
+	  tokensDtvcc(0.0),
+	  lastRefill(0),
+	  holding(false)
+{
+	setFrameRate(DEFAULT_FPS);
+	reset();
+}
+
+void CaptionPacer::setFrameRate(double framesPerSecond)
+{
+	fps = framesPerSecond > 0.0 ? framesPerSecond : DEFAULT_FPS;
+	rate608 = std::min(fps, MAX_608_PAIRS_PER_SECOND);
+	rateDtvcc = DTVCC_TRIPLETS_PER_SECOND;
+	tokens608 = std::min(tokens608, rate608 * BURST_SECONDS);
+	tokensDtvcc = std::min(tokensDtvcc, rateDtvcc * BURST_SECONDS);
+}
+
+void CaptionPacer::reset()
+{
+	tokens608 = rate608 * BURST_SECONDS;
+	tokensDtvcc = rateDtvcc * BURST_SECONDS;
+	lastRefill = 0;
+	holding = false;
+	counters = Stats();
+}
+
+void CaptionPacer::refill(int64_t now)
+{
+	if (lastRefill > 0 && now > lastRefill) {
+		double seconds = (now - lastRefill) / 1000.0;
+		tokens608 = std::min(tokens608 + seconds * rate608, rate608 * BURST_SECONDS);
+		tokensDtvcc = std::min(tokensDtvcc + seconds * rateDtvcc, rateDtvcc * BURST_SECONDS);
+	}
+	lastRefill = now;
+}
+
+int64_t CaptionPacer::backlogMs() const
+{
+	double seconds = std::max(-tokens608 / rate608, -tokensDtvcc / rateDtvcc);
+	return seconds > 0.0 ? (int64_t)std::ceil(seconds * 1000.0) : 0;
+}
+
+int64_t CaptionPacer::delay(int64_t now)
+{
+	refill(now);
+	return backlogMs();
+}
+
+void CaptionPacer::consumeCcData(const uint8_t *data, size_t size, int64_t now)
+{
+	refill(now);
+
+	size_t pairs608 = 0;
+	size_t triplets = 0;
+	for (size_t i = 0; i + 3 <= size; i += 3) {
+		uint8_t type = data[i] & 0x03;
+		if (type == CC_TYPE_NTSC_FIELD_1) {
+			pairs608++;
+		} else if (type == CC_TYPE_DTVCC_DATA || type == CC_TYPE_DTVCC_START) {
+			triplets++;
+		}
+	}
+
+	tokens608 -= (double)pairs608;
+	tokensDtvcc -= (double)triplets;
+	counters.triplets608 += pairs608;
+	counters.tripletsDtvcc += triplets;
+	counters.peakBacklogMs = std::max(counters.peakBacklogMs, backlogMs());
+	holding = false;
+}
+
+void CaptionPacer::consumeText(const char *text, size_t size, int64_t now)
+{
+	refill(now);
+
+	size_t pairs = textPairs608(text, size);
+	tokens608 -= (double)pairs;
+	counters.triplets608 += pairs;
+	counters.peakBacklogMs = std::max(counters.peakBacklogMs, backlogMs());
+	holding = false;
+}
+
+void CaptionPacer::defer()
+{
+	if (!holding) {
+		counters.deferred++;
+		holding = true;
+	}
+}
+
+void CaptionPacer::merge(uint64_t updates)
+{
+	if (holding) {
+		counters.merged += updates;
+	}
+}
+
+CaptionPacer::Stats CaptionPacer::stats(int64_t now)
+{
+	refill(now);
+	Stats result = counters;
+	result.backlogMs = backlogMs();
+	return result;
+}
+
+size_t CaptionPacer::textPairs608(const char *text, size_t size)
+{
+	// Text reaching here is already folded onto the 608 set: ASCII packs two
+	// characters per pair, anything else is a special or extended character
+	// with its own pair (and a fallback for extended ones)
+	size_t pairs = POP_ON_CONTROL_PAIRS + ROW_PREAMBLE_PAIRS;
+	size_t basic = 0;
+	for (size_t i = 0; i < size; i++) {
+		uint8_t c = (uint8_t)text[i];
+		if (c == '\n') {
+			pairs += ROW_PREAMBLE_PAIRS + (basic + 1) / 2;
+			basic = 0;
+		} else if (c < 0x80) {
+			basic++;
+		} else if (c >= 0xC0) {
+			// Lead byte of a multi-byte character; continuation bytes are skipped
+			pairs += 2;
+		}
+	}
+	return pairs + (basic + 1) / 2;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Token buckets modelling the caption bandwidth carried with the video.
+//
+// Each frame has room for a fixed number of cc_data triplets: one CEA-608
+// field 1 pair per frame (at most about 30 a second) and roughly 540 DTVCC
+// triplets a second for CEA-708. Whatever does not fit waits in the output
+// and shows up late. The pacer charges every caption against these budgets
+// and reports how long the next one must wait, so callers hold it back and
+// let later revisions replace it instead of piling up lag.
+//
+// Buckets may go negative after a large caption; that debt is the backlog
+// the output still has to drain.
+class CaptionPacer {
+public:
+	struct Stats {
+		int64_t backlogMs = 0;     // Time the channel needs for what was already sent
+		int64_t peakBacklogMs = 0;
+		uint64_t deferred = 0;     // Captions held back because the channel was busy
+		uint64_t merged = 0;       // Updates folded into a caption that was still held
+		uint64_t triplets608 = 0;  // Field 1 pairs charged
+		uint64_t tripletsDtvcc = 0;
+	};
+
+	CaptionPacer();
+
+	// Capacity scales with the output frame rate
+	void setFrameRate(double fps);
+	double frameRate() const { return fps; }
+
+	// Milliseconds until another caption fits, 0 if it fits now
+	int64_t delay(int64_t now);
+
+	// Charges cc_data triplets as built by CaptionEncoder
+	void consumeCcData(const uint8_t *data, size_t size, int64_t now);
+	// Charges a text caption, which libobs sends as a CEA-608 pop-on block
+	void consumeText(const char *text, size_t size, int64_t now);
+
+	// A due caption is waiting for the channel
+	void defer();
+	// Newer updates arrived while a caption was waiting; they replace it
+	void merge(uint64_t updates);
+
+	void reset();
+	Stats stats(int64_t now);
+
+	// Field 1 pairs libobs needs to send text as a pop-on caption
+	static size_t textPairs608(const char *text, size_t size);
+
+private:
+	void refill(int64_t now);
+	int64_t backlogMs() const;
+
+	double fps;
+	double rate608;   // Pairs per second
+	double rateDtvcc; // Triplets per second
+	double tokens608;
+	double tokensDtvcc;
+	int64_t lastRefill;
+	bool holding;
+	Stats counters;
+};
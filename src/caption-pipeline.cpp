@@ -0,0 +1,489 @@
+#include "caption-pipeline.h"
+
+#include <QtCore/QMutableMapIterator>
+
+// CEA-608 safe area: 32 columns, and pop-on blocks or roll-up windows of 3 rows
+static const int MAX_LINE_LENGTH = 32;
+static const int MAX_LINES = 3;
+
+// Display duration bounds in milliseconds. Every caption gets a fixed lead-in for
+// the eye to find it, plus reading time for its characters at the reading rate.
+static const int MIN_DURATION_MS = 1000;
+static const int MAX_DURATION_MS = 7000;
+static const int LEAD_IN_MS = 700;
+static const double CHARS_PER_WORD = 6.0; // Five letters and a space
+// A caption that would clear this close to the next expected one is held until then
+static const int BRIDGE_GAP_MS = 1000;
+// Gaps longer than this are pauses in speech, not caption cadence
+static const qint64 MAX_EXPECTED_INTERVAL_MS = 10000;
+// Marks a change of speaker (CEA-608 convention)
+static const char *SPEAKER_CHANGE = ">> ";
+// Pop-on pages allowed to queue behind the one on screen before the oldest are
+// skipped so captions keep up with speech
+static const int MAX_BACKLOG_PAGES = 2;
+
+CaptionPipeline::CaptionPipeline()
+	: nextSegmentKey(0.0),
+	  lastCaptionUpdate(0),
+	  duplicateCount(0),
+	  captionMode(Mode::PopOn),
+	  rolledSegmentId(0.0),
+	  hasRolledSegment(false),
+	  popOnWrapper(MAX_LINE_LENGTH),
+	  rollUpWrapper(MAX_LINE_LENGTH),
+	  pageSegmentId(0.0),
+	  hasPageSegment(false),
+	  pageWordOffset(0),
+	  pageShownAt(0),
+	  pageDuration(0),
+	  hasMorePages(false),
+	  pagedThroughId(-1.0),
+	  captionDirty(false),
+	  minInterval(0),
+	  lastCaptionSentTime(0),
+	  lastLogTime(0),
+	  readingRate(DEFAULT_READING_RATE_WPM),
+	  expectedInterval(0.0)
+{
+}
+
+CaptionPipeline::IngestResult CaptionPipeline::ingestSegment(double source_segment_id, const QString &text,
+							     bool is_final, bool is_revision, qint64 now,
+							     const QString &source)
+{
+	IngestResult result;
+	result.is_final = is_final;
+
+	double segment_id = source.isEmpty() ? source_segment_id : segmentKey(source, source_segment_id);
+
+	// Check if this is an update to existing segment
+	result.is_update = segments.contains(segment_id);
+
+	// Announce the new speaker when the segment before this one came from another source
+	QString displayed = text;
+	auto previous = segments.lowerBound(segment_id);
+	if (!source.isEmpty() && previous != segments.begin() && (--previous).value().source != source) {
+		displayed = SPEAKER_CHANGE + text;
+	}
+
+	// Store/update segment
+	segments[segment_id] = {displayed, segment_id, is_final, is_revision, now, source, source_segment_id};
+
+	// Build combined caption from all segments
+	QString composedCaption = buildCaptionFromSegments(now);
+
+	// Only update caption if this is a final segment or if enough time has passed
+	// This prevents too frequent updates from partial segments
+	qint64 timeSinceUpdate = now - lastCaptionUpdate;
+
+	// Update if: final segment, OR partial but 500ms passed (like obs-localvocal)
+	if (composedCaption != lastComposedCaption && (is_final || timeSinceUpdate > 500)) {
+		pendingCaptionText = composedCaption;
+		lastComposedCaption = composedCaption;
+		lastCaptionUpdate = now;
+		captionDirty = captionMode == Mode::PopOn;
+
+		result.changed = true;
+		result.text = composedCaption;
+	} else {
+		result.throttled = composedCaption != lastComposedCaption;
+	}
+
+	// Partials can still be revised, so roll-up only ever consumes final segments
+	if (captionMode == Mode::RollUp && is_final) {
+		rollUpFinalSegments();
+	}
+
+	return result;
+}
+
+CaptionPipeline::IngestResult CaptionPipeline::ingestText(const QString &text)
+{
+	IngestResult result;
+	result.is_final = true;
+
+	if (text != lastCaption) {
+		if (duplicateCount > 0) {
+			result.repeat_count = duplicateCount + 1;
+			duplicateCount = 0;
+		}
+		lastCaption = text;
+		pendingCaptionText = text;
+		// Each legacy message replaces the whole caption, so paging starts over
+		currentPage.clear();
+		hasMorePages = false;
+		if (captionMode == Mode::RollUp) {
+			appendRollUpLines(text);
+		} else {
+			captionDirty = true;
+		}
+
+		result.changed = true;
+		result.text = text;
+	} else {
+		duplicateCount++;
+	}
+
+	return result;
+}
+
+bool CaptionPipeline::takeCaption(qint64 now, Caption &caption)
+{
+	// Only send on change; the minimum interval keeps bursts of revisions from flickering
+	if (nextEmitDelay(now) != 0) {
+		return false;
+	}
+
+	qint64 interval = now - lastCaptionSentTime;
+	if (lastCaptionSentTime > 0 && interval < MAX_EXPECTED_INTERVAL_MS) {
+		expectedInterval = expectedInterval > 0.0 ? expectedInterval * 0.8 + interval * 0.2 : (double)interval;
+	}
+	lastCaptionSentTime = now;
+
+	if (captionMode == Mode::RollUp) {
+		// New lines enter at the bottom; anything beyond the window scrolls off
+		caption.appended = rollUpPending.join("\n").toUtf8();
+		for (const QString &line : rollUpPending) {
+			paging.deliveredChars += (quint64)line.length();
+		}
+		rollUpWindow.append(rollUpPending);
+		rollUpPending.clear();
+		while (rollUpWindow.size() > MAX_LINES) {
+			rollUpWindow.removeFirst();
+		}
+		caption.text = rollUpWindow.join("\n").toUtf8();
+		caption.roll_up = true;
+		// Lines already on screen were read before; only the new ones count
+		caption.duration = displayDuration(caption.appended);
+		return true;
+	}
+
+	// Move on once the page on screen has had its reading time
+	if (hasMorePages && now - pageShownAt >= pageDuration) {
+		advancePage(now);
+	}
+
+	QByteArray utf8 = pendingCaptionText.toUtf8();
+	const CaptionWrapper::Layout *layout = &popOnWrapper.wrap(utf8.constData(), (size_t)utf8.size());
+	int pages = ((int)layout->lines.size() + MAX_LINES - 1) / MAX_LINES;
+
+	// Falling too far behind: skip the oldest pages that have not been shown yet
+	if (currentPage.isEmpty() && pages - 1 > MAX_BACKLOG_PAGES) {
+		int skipPages = pages - 1 - MAX_BACKLOG_PAGES;
+		size_t skipped = CaptionWrapper::prefixSize(*layout, (size_t)(skipPages * MAX_LINES));
+		QString skippedText = QString::fromUtf8(layout->text.data(), (qsizetype)skipped);
+		paging.droppedChars += (quint64)skippedText.remove('\n').length();
+		skipPageWords(countWords(skippedText));
+		pendingCaptionText = segments.isEmpty() ? skipWords(pendingCaptionText, countWords(skippedText))
+							: buildCaptionFromSegments(now);
+		lastComposedCaption = pendingCaptionText;
+
+		utf8 = pendingCaptionText.toUtf8();
+		layout = &popOnWrapper.wrap(utf8.constData(), (size_t)utf8.size());
+		pages = ((int)layout->lines.size() + MAX_LINES - 1) / MAX_LINES;
+	}
+
+	captionDirty = false;
+	caption.text = formatCaption(pendingCaptionText);
+	caption.appended.clear();
+	caption.roll_up = false;
+
+	// Count only characters viewers have not seen on this page yet
+	int shown = QString::fromUtf8(currentPage).remove('\n').length();
+	int total = QString::fromUtf8(caption.text).remove('\n').length();
+	if (currentPage.isEmpty()) {
+		pageShownAt = now;
+	}
+	paging.deliveredChars += (quint64)qMax(total - shown, 0);
+	currentPage = caption.text;
+
+	hasMorePages = pages > 1;
+	paging.backlogPages = qMax(pages - 1, 0);
+	if (hasMorePages) {
+		// A backlog shortens each page so the queue drains instead of growing
+		pageDuration = qMax(readingTime(caption.text) / (1 + paging.backlogPages), (qint64)MIN_DURATION_MS);
+		caption.duration = (pageDuration + minInterval) / 1000.0;
+	} else {
+		caption.duration = displayDuration(caption.text);
+		if (!segments.isEmpty()) {
+			pagedThroughId = segments.lastKey();
+		}
+	}
+	return true;
+}
+
+void CaptionPipeline::advancePage(qint64 now)
+{
+	int words = countWords(QString::fromUtf8(currentPage));
+	currentPage.clear();
+	hasMorePages = false;
+
+	if (segments.isEmpty()) {
+		// Legacy captions page through the text itself
+		pendingCaptionText = skipWords(pendingCaptionText, words);
+	} else {
+		skipPageWords(words);
+		pendingCaptionText = buildCaptionFromSegments(now);
+		lastComposedCaption = pendingCaptionText;
+	}
+	captionDirty = !pendingCaptionText.isEmpty();
+}
+
+void CaptionPipeline::skipPageWords(int words)
+{
+	if (segments.isEmpty()) {
+		return;
+	}
+
+	auto it = hasPageSegment ? segments.lowerBound(pageSegmentId) : segments.begin();
+	for (; it != segments.end() && words > 0; ++it) {
+		int offset = hasPageSegment && it.key() == pageSegmentId ? pageWordOffset : 0;
+		int available = countWords(it.value().text) - offset;
+		int taken = qMin(words, qMax(available, 0));
+
+		pageSegmentId = it.key();
+		pageWordOffset = offset + taken;
+		hasPageSegment = true;
+		words -= taken;
+	}
+}
+
+int CaptionPipeline::countWords(const QString &text)
+{
+	int words = 0;
+	bool inWord = false;
+	for (const QChar &c : text) {
+		if (c.isSpace()) {
+			inWord = false;
+		} else if (!inWord) {
+			inWord = true;
+			words++;
+		}
+	}
+	return words;
+}
+
+QString CaptionPipeline::skipWords(const QString &text, int count)
+{
+	qsizetype i = 0;
+	for (int skipped = 0; skipped < count; skipped++) {
+		while (i < text.size() && text[i].isSpace()) {
+			i++;
+		}
+		while (i < text.size() && !text[i].isSpace()) {
+			i++;
+		}
+	}
+	while (i < text.size() && text[i].isSpace()) {
+		i++;
+	}
+	return text.mid(i);
+}
+
+double CaptionPipeline::displayDuration(const QByteArray &text) const
+{
+	double duration = (double)readingTime(text);
+
+	// Keep the screen from blanking just before the next caption is due
+	if (expectedInterval > duration && expectedInterval - duration <= BRIDGE_GAP_MS) {
+		duration = expectedInterval;
+	}
+
+	return qBound((double)MIN_DURATION_MS, duration, (double)MAX_DURATION_MS) / 1000.0;
+}
+
+qint64 CaptionPipeline::readingTime(const QByteArray &text) const
+{
+	qsizetype characters = QString::fromUtf8(text).remove('\n').length();
+	double charsPerMs = readingRate * CHARS_PER_WORD / 60000.0;
+	return LEAD_IN_MS + (qint64)(characters / charsPerMs);
+}
+
+void CaptionPipeline::setReadingRate(int wordsPerMinute)
+{
+	readingRate = qMax(wordsPerMinute, 1);
+}
+
+qint64 CaptionPipeline::nextEmitDelay(qint64 now) const
+{
+	bool pending = captionMode == Mode::RollUp ? !rollUpPending.isEmpty()
+						   : captionDirty && !pendingCaptionText.isEmpty();
+	qint64 elapsed = now - lastCaptionSentTime;
+	qint64 intervalRemaining = elapsed >= minInterval ? 0 : minInterval - elapsed;
+	if (pending) {
+		return intervalRemaining;
+	}
+
+	// The next pop-on page is due once the current one has been read
+	if (captionMode == Mode::PopOn && hasMorePages) {
+		return qMax(pageShownAt + pageDuration - now, intervalRemaining);
+	}
+	return -1;
+}
+
+bool CaptionPipeline::shouldLogEmission(qint64 now)
+{
+	if (now - lastLogTime > 5000) { // Log every 5 seconds to avoid spam
+		lastLogTime = now;
+		return true;
+	}
+	return false;
+}
+
+void CaptionPipeline::setMode(Mode mode)
+{
+	if (mode == captionMode) {
+		return;
+	}
+
+	captionMode = mode;
+
+	// Start the new mode from the current composition rather than replaying history
+	rollUpPending.clear();
+	rollUpWindow.clear();
+	hasRolledSegment = !segments.isEmpty();
+	if (hasRolledSegment) {
+		rolledSegmentId = segments.lastKey();
+	}
+	currentPage.clear();
+	hasMorePages = false;
+	captionDirty = mode == Mode::PopOn && !pendingCaptionText.isEmpty();
+}
+
+double CaptionPipeline::segmentKey(const QString &source, double segment_id)
+{
+	QPair<QString, double> id(source, segment_id);
+	auto it = sourceSegmentKeys.constFind(id);
+	if (it != sourceSegmentKeys.constEnd()) {
+		return it.value();
+	}
+
+	// Segments from different sources would collide or interleave by id; order them by first arrival instead
+	double key = segments.isEmpty() ? nextSegmentKey : qMax(nextSegmentKey, segments.lastKey() + 1.0);
+	nextSegmentKey = key + 1.0;
+	sourceSegmentKeys.insert(id, key);
+	return key;
+}
+
+void CaptionPipeline::reset()
+{
+	pendingCaptionText.clear();
+	segments.clear();
+	sourceSegmentKeys.clear();
+	nextSegmentKey = 0.0;
+	lastComposedCaption.clear();
+	lastCaptionUpdate = 0;
+	lastCaption.clear();
+	duplicateCount = 0;
+	rolledSegmentId = 0.0;
+	hasRolledSegment = false;
+	rollUpPending.clear();
+	rollUpWindow.clear();
+	captionDirty = false;
+	expectedInterval = 0.0;
+	pageSegmentId = 0.0;
+	hasPageSegment = false;
+	pageWordOffset = 0;
+	currentPage.clear();
+	pageShownAt = 0;
+	pageDuration = 0;
+	hasMorePages = false;
+	pagedThroughId = -1.0;
+	paging.backlogPages = 0;
+}
+
+QString CaptionPipeline::buildCaptionFromSegments(qint64 now)
+{
+	// Remove old segments (older than 10 seconds)
+	const qint64 SEGMENT_TIMEOUT = 10000; // 10 seconds
+
+	QMutableMapIterator<double, CaptionSegment> it(segments);
+	while (it.hasNext()) {
+		it.next();
+		if (now - it.value().timestamp > SEGMENT_TIMEOUT) {
+			// Text that expires before any page reached it never made it to viewers
+			double id = it.key();
+			bool pagedPast = hasPageSegment && id < pageSegmentId;
+			if (captionMode == Mode::PopOn && !pagedPast && id > pagedThroughId) {
+				int offset = hasPageSegment && id == pageSegmentId ? pageWordOffset : 0;
+				paging.droppedChars += (quint64)skipWords(it.value().text, offset).length();
+			}
+			if (!it.value().source.isEmpty()) {
+				sourceSegmentKeys.remove(qMakePair(it.value().source, it.value().source_segment_id));
+			}
+			it.remove();
+		}
+	}
+
+	// Build combined caption from remaining segments, starting at the current page
+	QString combinedCaption;
+	for (auto it = segments.begin(); it != segments.end(); ++it) {
+		if (hasPageSegment && it.key() < pageSegmentId) {
+			continue;
+		}
+		QString text = hasPageSegment && it.key() == pageSegmentId ? skipWords(it.value().text, pageWordOffset)
+									   : it.value().text;
+		if (text.isEmpty()) {
+			continue;
+		}
+		if (!combinedCaption.isEmpty()) {
+			combinedCaption += " ";
+		}
+		combinedCaption += text;
+	}
+
+	return combinedCaption;
+}
+
+void CaptionPipeline::rollUpFinalSegments()
+{
+	// Consume final segments in order, stopping at the first one still in progress
+	for (auto it = segments.begin(); it != segments.end(); ++it) {
+		const CaptionSegment &segment = it.value();
+		if (hasRolledSegment && segment.segment_id <= rolledSegmentId) {
+			continue;
+		}
+		if (!segment.is_final) {
+			break;
+		}
+
+		appendRollUpLines(segment.text);
+		rolledSegmentId = segment.segment_id;
+		hasRolledSegment = true;
+	}
+}
+
+void CaptionPipeline::appendRollUpLines(const QString &text)
+{
+	rollUpPending.append(wrapLines(text));
+
+	// Lines that would scroll off before they are ever shown are not worth sending
+	while (rollUpPending.size() > MAX_LINES) {
+		paging.droppedChars += (quint64)rollUpPending.first().length();
+		rollUpPending.removeFirst();
+	}
+}
+
+QStringList CaptionPipeline::wrapLines(const QString &text)
+{
+	QByteArray utf8 = text.toUtf8();
+	const CaptionWrapper::Layout &layout = rollUpWrapper.wrap(utf8.constData(), (size_t)utf8.size());
+
+	QStringList lines;
+	for (const CaptionWrapper::Line &line : layout.lines) {
+		lines.append(QString::fromUtf8(layout.text.data() + line.offset, (qsizetype)line.size));
+	}
+	return lines;
+}
+
+QByteArray CaptionPipeline::formatCaption(const QString &text)
+{
+	// CEA-708 Caption Formatting for Twitch Compliance
+	// Break text into rows of 32 display cells (max 3 lines = 96 cells total).
+	// Unchanged text comes straight from the wrapper's cache.
+	QByteArray utf8 = text.toUtf8();
+	const CaptionWrapper::Layout &layout = popOnWrapper.wrap(utf8.constData(), (size_t)utf8.size());
+
+	// Limit to max 3 lines
+	return QByteArray(layout.text.data(), (qsizetype)CaptionWrapper::prefixSize(layout, MAX_LINES));
+}
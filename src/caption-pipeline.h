@@ -0,0 +1,145 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMap>
+#include <QtCore/QPair>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include "caption-wrap.h"
+
+// Caption composition state for a single transcription feed.
+//
+// Everything that used to live in function-local statics of the dialog
+// (partial throttling, legacy duplicate detection, send debouncing and log
+// rate limiting) is owned by an instance of this class, so independent
+// pipelines never share state.
+class CaptionPipeline {
+public:
+	enum class Mode {
+		PopOn,  // Resend the whole wrapped block whenever the composition changes
+		RollUp, // Send completed lines only; earlier lines scroll up
+	};
+
+	struct Caption {
+		QByteArray text;     // Displayed caption, lines separated by '\n'
+		QByteArray appended; // Roll-up only: lines completed since the previous caption
+		bool roll_up = false;
+		double duration = 0.0; // Seconds on screen, from reading rate and caption cadence
+	};
+
+	// Character throughput of the pipeline: what reached viewers and what expired,
+	// scrolled off or was skipped to catch up before it could be shown
+	struct PagingStats {
+		quint64 deliveredChars = 0;
+		quint64 droppedChars = 0;
+		int backlogPages = 0; // Pop-on pages waiting behind the one on screen
+	};
+
+	struct IngestResult {
+		bool changed = false;     // Pending caption text was replaced
+		bool is_final = false;    // Message carried a final segment
+		bool is_update = false;   // Segment id was already known
+		bool throttled = false;   // Changed partial held back until 500 ms after the last update
+		int repeat_count = 0;     // Legacy format: times the previous caption was received
+		QString text;             // Composed caption when changed
+	};
+
+	// Reading speed display durations are derived from until setReadingRate() is called
+	static constexpr int DEFAULT_READING_RATE_WPM = 160;
+
+	CaptionPipeline();
+
+	// WhisperLive segment-based caption. Segments tagged with the audio source
+	// they were transcribed from are ordered by arrival across sources, and a
+	// change of source starts with the ">>" speaker change marker.
+	IngestResult ingestSegment(double segment_id, const QString &text, bool is_final, bool is_revision,
+				   qint64 now, const QString &source = QString());
+	// Legacy simple caption format
+	IngestResult ingestText(const QString &text);
+
+	// Returns the formatted caption if it changed since the last send and the
+	// minimum interval has elapsed
+	bool takeCaption(qint64 now, Caption &caption);
+	// Milliseconds until the pending caption may be sent, 0 if due now, -1 if nothing changed
+	qint64 nextEmitDelay(qint64 now) const;
+	void setMinInterval(qint64 interval) { minInterval = interval; }
+	void setReadingRate(int wordsPerMinute);
+	void setMode(Mode mode);
+	Mode mode() const { return captionMode; }
+	// Rate limit for debug logging of emitted captions
+	bool shouldLogEmission(qint64 now);
+
+	void reset();
+
+	const PagingStats &pagingStats() const { return paging; }
+
+private:
+	struct CaptionSegment {
+		QString text;
+		double segment_id;
+		bool is_final;
+		bool is_revision;
+		qint64 timestamp;
+		QString source;           // Audio source tag, empty for untagged feeds
+		double source_segment_id; // Id the server gave it within its source
+	};
+
+	double segmentKey(const QString &source, double segment_id);
+	QString buildCaptionFromSegments(qint64 now);
+	void advancePage(qint64 now);
+	void skipPageWords(int words);
+	qint64 readingTime(const QByteArray &text) const;
+	void rollUpFinalSegments();
+	void appendRollUpLines(const QString &text);
+	QStringList wrapLines(const QString &text);
+	QByteArray formatCaption(const QString &text);
+	double displayDuration(const QByteArray &text) const;
+	static int countWords(const QString &text);
+	static QString skipWords(const QString &text, int count);
+
+	QMap<double, CaptionSegment> segments;
+	// Tagged segments are keyed by arrival; the key each (source, id) got, and the next one to hand out
+	QMap<QPair<QString, double>, double> sourceSegmentKeys;
+	double nextSegmentKey;
+	QString pendingCaptionText;
+	QString lastComposedCaption;
+	qint64 lastCaptionUpdate;
+
+	QString lastCaption;
+	int duplicateCount;
+
+	Mode captionMode;
+
+	// Roll-up state: highest final segment already turned into lines, lines
+	// waiting to be sent and the rows currently on screen
+	double rolledSegmentId;
+	bool hasRolledSegment;
+	QStringList rollUpPending;
+	QStringList rollUpWindow;
+
+	// Separate wrappers so alternating pop-on and roll-up text never evicts the other's cache
+	CaptionWrapper popOnWrapper;
+	CaptionWrapper rollUpWrapper;
+
+	// Pop-on paging: composition starts pageWordOffset words into segment
+	// pageSegmentId; the page on screen and when its reading time runs out
+	double pageSegmentId;
+	bool hasPageSegment;
+	int pageWordOffset;
+	QByteArray currentPage;
+	qint64 pageShownAt;
+	qint64 pageDuration;
+	bool hasMorePages;
+	double pagedThroughId; // Segments up to here have been shown in full
+	PagingStats paging;
+
+	bool captionDirty;
+	qint64 minInterval;
+	qint64 lastCaptionSentTime;
+	qint64 lastLogTime;
+
+	// Adaptive duration: reading speed and a moving average of the time between sends
+	int readingRate;
+	double expectedInterval;
+};
@@ -0,0 +1,401 @@
+#include "caption-track.h"
+#include "caption-charset.h"
+#include "cJSON.h"
+#include <obs-module.h>
+#include <util/platform.h>
+#include "plugin-support.h"
+
+#include <QtCore/QDateTime>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+static const qint64 NEVER_DUE = std::numeric_limits<qint64>::max();
+
+CaptionTrack::CaptionTrack(int service, const QString &url, WorkerPool &pool, PipelineMetrics &metrics,
+			   PipelineTracer &tracer, FlightRecorder &recorder)
+	: serviceNumber(service),
+	  trackUrl(url),
+	  metrics(metrics),
+	  tracer(tracer),
+	  recorder(recorder),
+	  closing(false),
+	  messageCount(0),
+	  pendingReceivedAt(0),
+	  pendingMessage(0),
+	  pendingSegment(PipelineTracer::NO_SEGMENT),
+	  emittedMessage(0),
+	  emittedSegment(PipelineTracer::NO_SEGMENT),
+	  latency(0),
+	  latencyAverage(0.0),
+	  dueAt(NEVER_DUE),
+	  queue(pool)
+{
+}
+
+CaptionTrack::~CaptionTrack()
+{
+	// Destroying the backend joins its threads, so nothing new can be queued
+	transcriber.reset();
+	queue.waitIdle();
+}
+
+void CaptionTrack::setConnectHandler(ConnectHandler handler)
+{
+	connectHandler = std::move(handler);
+}
+
+void CaptionTrack::setLogHandler(LogHandler handler)
+{
+	logHandler = std::move(handler);
+}
+
+void CaptionTrack::setChangeHandler(ChangeHandler handler)
+{
+	changeHandler = std::move(handler);
+}
+
+bool CaptionTrack::connect()
+{
+	transcriber.reset();
+	closing.store(false, std::memory_order_relaxed);
+
+	transcriber = TranscriptionBackend::create(trackUrl.toStdString());
+	if (!transcriber) {
+		log("Error: Failed to create transcription backend");
+		return false;
+	}
+
+	// Network backends hand over messages, in-process ones finished segments; both are handled on the pool
+	transcriber->setConnectHandler([this](bool connected) {
+		metrics.add(connected ? PipelineMetrics::Connects : PipelineMetrics::Disconnects);
+		if (connected) {
+			recorder.record(FlightRecorder::Connected, serviceNumber);
+		} else {
+			bool requested = closing.load(std::memory_order_relaxed);
+			recorder.record(FlightRecorder::Disconnected, serviceNumber, 0, requested ? 1 : 0);
+			if (!requested) {
+				recorder.trigger(FlightRecorder::ConnectionLost, serviceNumber);
+			}
+		}
+		if (connectHandler) {
+			connectHandler(this, connected);
+		}
+	});
+	transcriber->setMessageHandler([this](const char *message, size_t len) {
+		qint64 received = QDateTime::currentMSecsSinceEpoch();
+		metrics.add(PipelineMetrics::MessagesReceived);
+		metrics.add(PipelineMetrics::BytesIn, len);
+		uint64_t number = ++messageCount;
+		recorder.record(FlightRecorder::Frame, serviceNumber, number, (int64_t)len);
+		tracer.record(PipelineTracer::Receive, PipelineTracer::Instant, serviceNumber, number);
+		// Copy the message since it might not be valid after this function returns
+		std::string msg(message, len);
+		metrics.adjust(PipelineMetrics::QueueDepth, 1);
+		tracer.record(PipelineTracer::Queue, PipelineTracer::Begin, serviceNumber, number);
+		queue.post([this, msg, received, number]() {
+			metrics.adjust(PipelineMetrics::QueueDepth, -1);
+			tracer.record(PipelineTracer::Queue, PipelineTracer::End, serviceNumber, number);
+			processMessage(msg, received, number);
+		});
+	});
+	transcriber->setSegmentHandler([this](const TranscriptionBackend::Segment &segment) {
+		qint64 received = QDateTime::currentMSecsSinceEpoch();
+		metrics.add(PipelineMetrics::MessagesReceived);
+		uint64_t number = ++messageCount;
+		recorder.record(FlightRecorder::Frame, serviceNumber, number, (int64_t)segment.text.size());
+		tracer.record(PipelineTracer::Receive, PipelineTracer::Instant, serviceNumber, number, segment.id);
+		metrics.adjust(PipelineMetrics::QueueDepth, 1);
+		tracer.record(PipelineTracer::Queue, PipelineTracer::Begin, serviceNumber, number, segment.id);
+		queue.post([this, segment, received, number]() {
+			metrics.adjust(PipelineMetrics::QueueDepth, -1);
+			tracer.record(PipelineTracer::Queue, PipelineTracer::End, serviceNumber, number, segment.id);
+			processSegment(segment, received, number);
+		});
+	});
+
+	if (!transcriber->connect()) {
+		log("Error: Failed to initiate connection");
+		return false;
+	}
+
+	return true;
+}
+
+void CaptionTrack::disconnect()
+{
+	if (transcriber) {
+		closing.store(true, std::memory_order_relaxed);
+		transcriber->disconnect();
+	}
+}
+
+bool CaptionTrack::isConnected() const
+{
+	return transcriber && transcriber->isConnected();
+}
+
+void CaptionTrack::send(const char *json)
+{
+	if (transcriber) {
+		transcriber->sendControl(json);
+		metrics.add(PipelineMetrics::BytesOut, strlen(json));
+	}
+}
+
+bool CaptionTrack::takeCaption(qint64 now, CaptionPipeline::Caption &caption)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bool taken = pipeline.takeCaption(now, caption);
+	publishDue(now);
+	if (!taken) {
+		return false;
+	}
+
+	// Only the first send of a new caption counts towards latency
+	if (pendingReceivedAt > 0) {
+		tracer.record(PipelineTracer::Hold, PipelineTracer::End, serviceNumber, pendingMessage, pendingSegment);
+		emittedMessage = pendingMessage;
+		emittedSegment = pendingSegment;
+		latency = now - pendingReceivedAt;
+		latencyAverage = latencyAverage > 0.0 ? latencyAverage * 0.9 + latency * 0.1 : (double)latency;
+		pendingReceivedAt = 0;
+		metrics.add(PipelineMetrics::CaptionsEmitted);
+		metrics.record(PipelineMetrics::CaptionLatency, (uint64_t)std::max<qint64>(latency, 0) * 1000);
+		recorder.record(FlightRecorder::Emit, serviceNumber, emittedMessage, latency);
+		if (latency > FlightRecorder::LATENCY_SLO_MS) {
+			recorder.trigger(FlightRecorder::LatencyBreach, serviceNumber);
+		}
+	}
+	return true;
+}
+
+void CaptionTrack::traceEmit(PipelineTracer::Phase phase) const
+{
+	tracer.record(PipelineTracer::Emit, phase, serviceNumber, emittedMessage, emittedSegment);
+}
+
+void CaptionTrack::setMinInterval(qint64 interval)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pipeline.setMinInterval(interval);
+	publishDue(QDateTime::currentMSecsSinceEpoch());
+}
+
+void CaptionTrack::setReadingRate(int wordsPerMinute)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pipeline.setReadingRate(wordsPerMinute);
+}
+
+void CaptionTrack::setMode(CaptionPipeline::Mode mode)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pipeline.setMode(mode);
+	publishDue(QDateTime::currentMSecsSinceEpoch());
+}
+
+bool CaptionTrack::shouldLogEmission(qint64 now)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pipeline.shouldLogEmission(now);
+}
+
+void CaptionTrack::reset()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pipeline.reset();
+	pendingReceivedAt = 0;
+	dueAt.store(NEVER_DUE, std::memory_order_release);
+}
+
+qint64 CaptionTrack::lastLatency() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return latency;
+}
+
+double CaptionTrack::averageLatency() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return latencyAverage;
+}
+
+CaptionPipeline::PagingStats CaptionTrack::pagingStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pipeline.pagingStats();
+}
+
+void CaptionTrack::log(const QString &line)
+{
+	if (logHandler) {
+		logHandler(this, line);
+	}
+}
+
+void CaptionTrack::notePending(const CaptionPipeline::IngestResult &result, qint64 received, uint64_t message,
+			       double segment)
+{
+	if (result.throttled) {
+		tracer.record(PipelineTracer::Throttle, PipelineTracer::Instant, serviceNumber, message, segment);
+	}
+	// A caption already waiting keeps its arrival time, so latency covers the whole wait
+	if (result.changed && pendingReceivedAt == 0) {
+		pendingReceivedAt = received;
+		pendingMessage = message;
+		pendingSegment = segment;
+		tracer.record(PipelineTracer::Hold, PipelineTracer::Begin, serviceNumber, message, segment);
+	}
+}
+
+void CaptionTrack::publishDue(qint64 now)
+{
+	qint64 delay = pipeline.nextEmitDelay(now);
+	dueAt.store(delay < 0 ? NEVER_DUE : now + delay, std::memory_order_release);
+}
+
+void CaptionTrack::notifyChanged()
+{
+	if (changeHandler) {
+		changeHandler(this);
+	}
+}
+
+void CaptionTrack::processMessage(const std::string &json, qint64 received, uint64_t message)
+{
+	tracer.record(PipelineTracer::Parse, PipelineTracer::Begin, serviceNumber, message);
+	uint64_t parseStart = os_gettime_ns();
+	cJSON *root = cJSON_Parse(json.c_str());
+	uint64_t parseTime = (os_gettime_ns() - parseStart) / 1000;
+	metrics.record(PipelineMetrics::ParseTime, parseTime);
+	tracer.record(PipelineTracer::Parse, PipelineTracer::End, serviceNumber, message);
+	if (!root) {
+		metrics.add(PipelineMetrics::ParseErrors);
+		recorder.record(FlightRecorder::ParseError, serviceNumber, message, (int64_t)parseTime);
+		recorder.trigger(FlightRecorder::ParseFailure, serviceNumber);
+		log("✗ Failed to parse WebSocket message");
+		return;
+	}
+
+	recorder.record(FlightRecorder::Parse, serviceNumber, message, (int64_t)parseTime);
+
+	cJSON *type = cJSON_GetObjectItem(root, "type");
+	if (!type || !cJSON_IsString(type)) {
+		metrics.add(PipelineMetrics::ParseErrors);
+		recorder.record(FlightRecorder::ParseError, serviceNumber, message, (int64_t)parseTime);
+		recorder.trigger(FlightRecorder::ParseFailure, serviceNumber);
+		log("✗ WebSocket message missing 'type' field");
+		cJSON_Delete(root);
+		return;
+	}
+
+	const char *message_type = cJSON_GetStringValue(type);
+
+	if (strcmp(message_type, "connected") == 0) {
+		// Channel is implicitly joined via connection
+		log("✓ WebSocket connected");
+	} else if (strcmp(message_type, "transcription") == 0) {
+		// Handle transcription messages with WhisperLive segment support
+		cJSON *data = cJSON_GetObjectItem(root, "data");
+		cJSON *text_item = data ? cJSON_GetObjectItem(data, "text") : nullptr;
+		const char *caption_text = cJSON_IsString(text_item) ? cJSON_GetStringValue(text_item) : nullptr;
+		// Extract segment metadata if available (WhisperLive protocol)
+		cJSON *segment_id_item = caption_text ? cJSON_GetObjectItem(data, "segment_id") : nullptr;
+
+		if (segment_id_item && cJSON_IsNumber(segment_id_item)) {
+			// WhisperLive segment-based caption
+			cJSON *is_revision_item = cJSON_GetObjectItem(data, "is_revision");
+			cJSON *is_final_item = cJSON_GetObjectItem(data, "is_final");
+			// Tag of the uplink audio stream the segment was transcribed from
+			cJSON *source_item = cJSON_GetObjectItem(data, "source");
+
+			TranscriptionBackend::Segment segment;
+			segment.id = cJSON_GetNumberValue(segment_id_item);
+			segment.text = caption_text;
+			segment.isRevision = is_revision_item ? cJSON_IsTrue(is_revision_item) : false;
+			segment.isFinal = is_final_item ? cJSON_IsTrue(is_final_item) : true;
+			segment.source = cJSON_IsString(source_item) ? cJSON_GetStringValue(source_item) : "";
+			processSegment(segment, received, message);
+		} else if (caption_text) {
+			// Legacy simple caption format, folded onto the caption character set once here
+			std::string folded;
+			if (caption_charset_fold(caption_text, strlen(caption_text), folded)) {
+				caption_text = folded.c_str();
+			}
+			QString text = QString::fromUtf8(caption_text);
+
+			CaptionPipeline::IngestResult result;
+			tracer.record(PipelineTracer::Compose, PipelineTracer::Begin, serviceNumber, message);
+			uint64_t composeStart = os_gettime_ns();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				result = pipeline.ingestText(text);
+				publishDue(received);
+				notePending(result, received, message, PipelineTracer::NO_SEGMENT);
+			}
+			uint64_t composeTime = (os_gettime_ns() - composeStart) / 1000;
+			metrics.record(PipelineMetrics::ComposeTime, composeTime);
+			recorder.record(FlightRecorder::Compose, serviceNumber, message, (int64_t)composeTime);
+			tracer.record(PipelineTracer::Compose, PipelineTracer::End, serviceNumber, message);
+
+			if (result.repeat_count > 0) {
+				log(QString("  (received %1 times)").arg(result.repeat_count));
+			}
+			if (result.changed) {
+				notifyChanged();
+
+				// Truncate long captions in log for readability
+				QString logText = text.length() > 50 ? text.left(47) + "..." : text;
+				log(QString("📝 %1").arg(logText));
+			}
+		}
+	} else if (strcmp(message_type, "error") == 0) {
+		cJSON *message = cJSON_GetObjectItem(root, "message");
+		const char *error_msg = cJSON_IsString(message) ? cJSON_GetStringValue(message) : "Unknown error";
+		log(QString("✗ Server error: %1").arg(error_msg));
+	} else if (strcmp(message_type, "pong") == 0) {
+		// Don't log pongs - too noisy
+	}
+
+	cJSON_Delete(root);
+}
+
+void CaptionTrack::processSegment(const TranscriptionBackend::Segment &segment, qint64 received, uint64_t message)
+{
+	// Fold onto the caption character set once here rather than on every send
+	std::string folded;
+	const char *caption_text = segment.text.c_str();
+	if (caption_charset_fold(caption_text, segment.text.size(), folded)) {
+		caption_text = folded.c_str();
+	}
+	QString text = QString::fromUtf8(caption_text);
+	QString source = QString::fromStdString(segment.source);
+
+	CaptionPipeline::IngestResult result;
+	tracer.record(PipelineTracer::Compose, PipelineTracer::Begin, serviceNumber, message, segment.id);
+	uint64_t composeStart = os_gettime_ns();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		result = pipeline.ingestSegment(segment.id, text, segment.isFinal, segment.isRevision, received,
+						source);
+		publishDue(received);
+		notePending(result, received, message, segment.id);
+	}
+	uint64_t composeTime = (os_gettime_ns() - composeStart) / 1000;
+	metrics.record(PipelineMetrics::ComposeTime, composeTime);
+	recorder.record(FlightRecorder::Compose, serviceNumber, message, (int64_t)composeTime);
+	tracer.record(PipelineTracer::Compose, PipelineTracer::End, serviceNumber, message, segment.id);
+
+	if (result.changed) {
+		notifyChanged();
+
+		// Log the change
+		QString logText = result.text.length() > 50 ? result.text.left(47) + "..." : result.text;
+		QString statusIcon = result.is_final ? "📝" : "✏️";
+		QString updateType = result.is_update ? " (revised)" : "";
+		QString sourceTag = source.isEmpty() ? "" : QString("[%1] ").arg(source);
+		log(QString("%1 %2%3%4").arg(statusIcon).arg(sourceTag).arg(logText).arg(updateType));
+	}
+}
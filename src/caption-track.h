@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "caption-pipeline.h"
+#include "flight-recorder.h"
+#include "pipeline-metrics.h"
+#include "pipeline-tracer.h"
+#include "transcription-backend.h"
+#include "worker-pool.h"
+
+// One transcription feed: its TranscriptionBackend, its own segment store
+// and the CEA-708 caption service number its captions are multiplexed onto.
+//
+// Messages and segments are parsed and composed on the shared WorkerPool
+// (serialised per track), so the emitter only picks up finished captions.
+// Traffic, parse and composition times and caption latency are recorded in
+// the shared PipelineMetrics, and each stage in the PipelineTracer when
+// tracing is on. The FlightRecorder always keeps the latest events and is
+// told to dump them on an unrequested disconnect, a parse failure or a late
+// caption.
+class CaptionTrack {
+public:
+	typedef std::function<void(CaptionTrack *track, bool connected)> ConnectHandler;
+	typedef std::function<void(CaptionTrack *track, const QString &line)> LogHandler;
+	typedef std::function<void(CaptionTrack *track)> ChangeHandler;
+
+	CaptionTrack(int service, const QString &url, WorkerPool &pool, PipelineMetrics &metrics,
+		     PipelineTracer &tracer, FlightRecorder &recorder);
+	~CaptionTrack();
+
+	CaptionTrack(const CaptionTrack &) = delete;
+	CaptionTrack &operator=(const CaptionTrack &) = delete;
+
+	// Handlers are invoked from network and worker threads
+	void setConnectHandler(ConnectHandler handler);
+	void setLogHandler(LogHandler handler);
+	// Called whenever the composed caption changes
+	void setChangeHandler(ChangeHandler handler);
+
+	bool connect();
+	void disconnect();
+	bool isConnected() const;
+	void send(const char *json);
+	// Valid from connect() until the track is destroyed or reconnected
+	TranscriptionBackend *backend() const { return transcriber.get(); }
+
+	// Lock-free check, cheap enough to poll every frame: true once takeCaption would return a caption
+	bool captionDue(qint64 now) const { return now >= dueAt.load(std::memory_order_acquire); }
+	// Returns the formatted caption if one is due
+	bool takeCaption(qint64 now, CaptionPipeline::Caption &caption);
+	// Traces sending the caption takeCaption() returned last; same thread as takeCaption()
+	void traceEmit(PipelineTracer::Phase phase) const;
+	void setMinInterval(qint64 interval);
+	void setReadingRate(int wordsPerMinute);
+	void setMode(CaptionPipeline::Mode mode);
+	bool shouldLogEmission(qint64 now);
+	void reset();
+
+	int service() const { return serviceNumber; }
+	const QString &url() const { return trackUrl; }
+
+	// Receive-to-emit latency of the most recent caption, and a moving average
+	qint64 lastLatency() const;
+	double averageLatency() const;
+	CaptionPipeline::PagingStats pagingStats() const;
+
+private:
+	void processMessage(const std::string &json, qint64 received, uint64_t message);
+	void processSegment(const TranscriptionBackend::Segment &segment, qint64 received, uint64_t message);
+	// Call with the mutex held once the pipeline took an update
+	void notePending(const CaptionPipeline::IngestResult &result, qint64 received, uint64_t message,
+			 double segment);
+	void log(const QString &line);
+	void notifyChanged();
+	void publishDue(qint64 now);
+
+	int serviceNumber;
+	QString trackUrl;
+	PipelineMetrics &metrics;
+	PipelineTracer &tracer;
+	FlightRecorder &recorder;
+	std::unique_ptr<TranscriptionBackend> transcriber;
+	std::atomic<bool> closing; // Set by disconnect() so the close it asked for is not dumped
+	uint64_t messageCount; // Numbers messages for the trace; backend thread only
+
+	ConnectHandler connectHandler;
+	LogHandler logHandler;
+	ChangeHandler changeHandler;
+
+	mutable std::mutex mutex;
+	CaptionPipeline pipeline;
+	qint64 pendingReceivedAt; // Arrival of the message behind the pending caption, 0 once emitted
+	uint64_t pendingMessage;
+	double pendingSegment;
+	// Trace keys of the caption taken last, only touched by the thread taking captions
+	uint64_t emittedMessage;
+	double emittedSegment;
+	qint64 latency;
+	double latencyAverage;
+
+	// When the pipeline next has a caption to send, updated under the mutex
+	// whenever its state changes; never if nothing is pending
+	std::atomic<qint64> dueAt;
+
+	// Declared last so queued tasks are drained before anything above is destroyed
+	SerialQueue queue;
+};
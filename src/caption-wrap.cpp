@@ -0,0 +1,241 @@
+#include "caption-wrap.h"
+#include "utf8.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+struct Range {
+	uint32_t first;
+	uint32_t last;
+};
+
+// East Asian Wide and Fullwidth blocks plus emoji, which terminals and caption
+// decoders draw two cells wide
+constexpr Range WIDE[] = {
+	{0x1100, 0x115F},   {0x231A, 0x231B},   {0x2329, 0x232A},   {0x23E9, 0x23EC},   {0x23F0, 0x23F0},
+	{0x23F3, 0x23F3},   {0x25FD, 0x25FE},   {0x2614, 0x2615},   {0x2648, 0x2653},   {0x267F, 0x267F},
+	{0x2693, 0x2693},   {0x26A1, 0x26A1},   {0x26AA, 0x26AB},   {0x26BD, 0x26BE},   {0x26C4, 0x26C5},
+	{0x26CE, 0x26CE},   {0x26D4, 0x26D4},   {0x26EA, 0x26EA},   {0x26F2, 0x26F3},   {0x26F5, 0x26F5},
+	{0x26FA, 0x26FA},   {0x26FD, 0x26FD},   {0x2705, 0x2705},   {0x270A, 0x270B},   {0x2728, 0x2728},
+	{0x274C, 0x274C},   {0x274E, 0x274E},   {0x2753, 0x2755},   {0x2757, 0x2757},   {0x2795, 0x2797},
+	{0x27B0, 0x27B0},   {0x27BF, 0x27BF},   {0x2B1B, 0x2B1C},   {0x2B50, 0x2B50},   {0x2B55, 0x2B55},
+	{0x2E80, 0x303E},   {0x3041, 0x33FF},   {0x3400, 0x4DBF},   {0x4E00, 0x9FFF},   {0xA000, 0xA4CF},
+	{0xA960, 0xA97F},   {0xAC00, 0xD7A3},   {0xF900, 0xFAFF},   {0xFE10, 0xFE19},   {0xFE30, 0xFE6F},
+	{0xFF00, 0xFF60},   {0xFFE0, 0xFFE6},   {0x16FE0, 0x16FE4}, {0x17000, 0x18AFF}, {0x1B000, 0x1B2FF},
+	{0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F251},
+	{0x1F300, 0x1F64F}, {0x1F680, 0x1F6FF}, {0x1F7E0, 0x1F7EB}, {0x1F90C, 0x1F9FF}, {0x1FA70, 0x1FAFF},
+	{0x20000, 0x2FFFD}, {0x30000, 0x3FFFD},
+};
+
+// Combining marks, format characters and other code points drawn with no width
+// of their own; inside a cluster they extend the preceding character
+constexpr Range ZERO_WIDTH[] = {
+	{0x0000, 0x001F},   {0x007F, 0x009F},   {0x00AD, 0x00AD},   {0x0300, 0x036F},   {0x0483, 0x0489},
+	{0x0591, 0x05BD},   {0x05BF, 0x05BF},   {0x05C1, 0x05C2},   {0x05C4, 0x05C5},   {0x05C7, 0x05C7},
+	{0x0610, 0x061A},   {0x064B, 0x065F},   {0x0670, 0x0670},   {0x06D6, 0x06DC},   {0x06DF, 0x06E4},
+	{0x06E7, 0x06E8},   {0x06EA, 0x06ED},   {0x0900, 0x0903},   {0x093A, 0x094F},   {0x0951, 0x0957},
+	{0x0962, 0x0963},   {0x0E31, 0x0E31},   {0x0E34, 0x0E3A},   {0x0E47, 0x0E4E},   {0x1AB0, 0x1AFF},
+	{0x1DC0, 0x1DFF},   {0x200B, 0x200F},   {0x2028, 0x202E},   {0x2060, 0x2064},   {0x20D0, 0x20FF},
+	{0x302A, 0x302F},   {0x3099, 0x309A},   {0xFE00, 0xFE0F},   {0xFE20, 0xFE2F},   {0xFEFF, 0xFEFF},
+	{0x1F3FB, 0x1F3FF}, {0xE0000, 0xE0FFF},
+};
+
+template<size_t N> constexpr bool sorted_ranges(const Range (&table)[N])
+{
+	for (size_t i = 0; i < N; i++) {
+		if (table[i].first > table[i].last || (i > 0 && table[i - 1].last >= table[i].first)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static_assert(sorted_ranges(WIDE), "WIDE must be sorted and disjoint");
+static_assert(sorted_ranges(ZERO_WIDTH), "ZERO_WIDTH must be sorted and disjoint");
+
+template<size_t N> bool in_ranges(const Range (&table)[N], uint32_t cp)
+{
+	if (cp < table[0].first || cp > table[N - 1].last) {
+		return false;
+	}
+	const Range *it = std::upper_bound(table, table + N, cp,
+					   [](uint32_t value, const Range &range) { return value < range.first; });
+	return it != table && cp <= (it - 1)->last;
+}
+
+constexpr uint32_t ZWJ = 0x200D;
+constexpr uint32_t EMOJI_PRESENTATION = 0xFE0F;
+
+bool is_regional_indicator(uint32_t cp)
+{
+	return cp >= 0x1F1E6 && cp <= 0x1F1FF;
+}
+
+bool is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Advances past one grapheme cluster and reports its display width
+const char *next_cluster(const char *p, const char *end, int &width)
+{
+	uint32_t cp = utf8_next(p, end);
+	width = CaptionWrapper::codepointWidth(cp);
+	bool regional = is_regional_indicator(cp);
+	bool joined = false;
+
+	while (p < end) {
+		const char *q = p;
+		uint32_t next = utf8_next(q, end);
+
+		if (joined) {
+			// The character after a ZWJ is drawn as part of the same glyph
+			joined = false;
+		} else if (next == ZWJ) {
+			joined = true;
+		} else if (next == EMOJI_PRESENTATION) {
+			width = 2;
+		} else if (regional && is_regional_indicator(next)) {
+			// Two regional indicators form one flag
+			regional = false;
+			width = 2;
+		} else if (!in_ranges(ZERO_WIDTH, next) || next < 0x20) {
+			break;
+		}
+		p = q;
+	}
+	return p;
+}
+
+uint64_t hash_bytes(const char *text, size_t size)
+{
+	// FNV-1a
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= (uint8_t)text[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+} // namespace
+
+CaptionWrapper::CaptionWrapper(int columns)
+	: maxColumns(std::max(columns, 1)),
+	  lineOffset(0),
+	  lineWidth(0),
+	  lineOpen(false),
+	  cachedHash(0),
+	  cacheValid(false)
+{
+}
+
+int CaptionWrapper::codepointWidth(uint32_t cp)
+{
+	if (cp >= 0x20 && cp < 0x7F) {
+		return 1;
+	}
+	if (in_ranges(ZERO_WIDTH, cp)) {
+		return 0;
+	}
+	return in_ranges(WIDE, cp) ? 2 : 1;
+}
+
+const CaptionWrapper::Layout &CaptionWrapper::wrap(const char *text, size_t size)
+{
+	uint64_t hash = hash_bytes(text, size);
+	if (cacheValid && hash == cachedHash && cachedInput.size() == size &&
+	    memcmp(cachedInput.data(), text, size) == 0) {
+		return layout;
+	}
+
+	layoutText(text, size);
+
+	cachedInput.assign(text, size);
+	cachedHash = hash;
+	cacheValid = true;
+	return layout;
+}
+
+size_t CaptionWrapper::prefixSize(const Layout &layout, size_t count)
+{
+	if (count == 0 || layout.lines.empty()) {
+		return 0;
+	}
+	const Line &last = layout.lines[std::min(count, layout.lines.size()) - 1];
+	return last.offset + last.size;
+}
+
+void CaptionWrapper::closeLine()
+{
+	if (!lineOpen) {
+		return;
+	}
+	layout.lines.push_back({lineOffset, layout.text.size() - lineOffset, lineWidth});
+	lineOpen = false;
+}
+
+void CaptionWrapper::append(const char *begin, const char *end, int width)
+{
+	if (!lineOpen) {
+		if (!layout.lines.empty()) {
+			layout.text.push_back('\n');
+		}
+		lineOffset = layout.text.size();
+		lineWidth = 0;
+		lineOpen = true;
+	}
+	layout.text.append(begin, end - begin);
+	lineWidth += width;
+}
+
+void CaptionWrapper::layoutText(const char *text, size_t size)
+{
+	// clear() keeps capacity, so repeated layouts reuse the same buffers
+	layout.text.clear();
+	layout.lines.clear();
+	lineOpen = false;
+
+	const char *p = text;
+	const char *end = text + size;
+	while (p < end) {
+		if (is_space(*p)) {
+			p++;
+			continue;
+		}
+
+		// Measure the next word
+		const char *wordEnd = p;
+		int wordWidth = 0;
+		while (wordEnd < end && !is_space(*wordEnd)) {
+			int width;
+			wordEnd = next_cluster(wordEnd, end, width);
+			wordWidth += width;
+		}
+
+		if (lineOpen && lineWidth + 1 + wordWidth <= maxColumns) {
+			layout.text.push_back(' ');
+			append(p, wordEnd, wordWidth + 1);
+		} else if (wordWidth <= maxColumns) {
+			closeLine();
+			append(p, wordEnd, wordWidth);
+		} else {
+			// Longer than a whole row: break between clusters
+			closeLine();
+			while (p < wordEnd) {
+				int width;
+				const char *next = next_cluster(p, wordEnd, width);
+				if (lineOpen && lineWidth + width > maxColumns) {
+					closeLine();
+				}
+				append(p, next, width);
+				p = next;
+			}
+		}
+		p = wordEnd;
+	}
+
+	closeLine();
+}
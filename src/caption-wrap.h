@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Greedy word wrap for caption rows, measured in display cells.
+//
+// Works directly on UTF-8. A grapheme cluster (a base character with its
+// combining marks, ZWJ emoji sequences, flag pairs) is never split, and wide
+// East Asian characters and emoji take two cells. The last layout is cached
+// keyed on the hash of the input, so rewrapping unchanged text does no work,
+// and buffers keep their capacity so a cache miss rarely allocates.
+class CaptionWrapper {
+public:
+	struct Line {
+		size_t offset; // Into Layout::text
+		size_t size;   // Bytes, without the trailing '\n'
+		int width;     // Display cells
+	};
+
+	struct Layout {
+		std::string text; // All lines joined with '\n'
+		std::vector<Line> lines;
+	};
+
+	explicit CaptionWrapper(int columns);
+
+	const Layout &wrap(const char *text, size_t size);
+	const Layout &wrap(const std::string &text) { return wrap(text.data(), text.size()); }
+
+	// Byte length of the first count lines in the layout, for taking a prefix of text
+	static size_t prefixSize(const Layout &layout, size_t count);
+
+	int columns() const { return maxColumns; }
+
+	// Display width of a single code point: 0, 1 or 2 cells
+	static int codepointWidth(uint32_t cp);
+
+private:
+	void layoutText(const char *text, size_t size);
+	void append(const char *begin, const char *end, int width);
+	void closeLine();
+
+	int maxColumns;
+
+	Layout layout;
+	size_t lineOffset;
+	int lineWidth;
+	bool lineOpen;
+
+	uint64_t cachedHash;
+	std::string cachedInput;
+	bool cacheValid;
+};
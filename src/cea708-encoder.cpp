@@ -0,0 +1,348 @@
+#include "cea708-encoder.h"
+#include "cea708-tables.h"
+#include "utf8.h"
+
+#include <algorithm>
+
+using namespace cea708;
+
+template<typename T, size_t N> static const T *find_codepoint(const T (&table)[N], uint32_t cp)
+{
+	const T *it = std::lower_bound(table, table + N, cp,
+				       [](const T &entry, uint32_t value) { return entry.codepoint < value; });
+	return it != table + N && it->codepoint == cp ? it : nullptr;
+}
+
+CaptionEncoder::CaptionEncoder() : mode608(Mode608::None), pendingChar608(-1), dtvccSequence(0) {}
+
+void CaptionEncoder::reset()
+{
+	ccData.clear();
+	mode608 = Mode608::None;
+	pendingChar608 = -1;
+	for (ServiceState &state : services) {
+		state = ServiceState();
+	}
+	dtvccPayload.clear();
+	dtvccSequence = 0;
+}
+
+// ---------------------------------------------------------------------------
+// CEA-608
+
+void CaptionEncoder::pair608(uint8_t first, uint8_t second)
+{
+	ccData.push_back(CC_MARKER | CC_VALID | CC_TYPE_NTSC_FIELD_1);
+	ccData.push_back(PARITY[first & 0x7F]);
+	ccData.push_back(PARITY[second & 0x7F]);
+}
+
+void CaptionEncoder::flushChar608()
+{
+	if (pendingChar608 >= 0) {
+		pair608((uint8_t)pendingChar608, 0x00);
+		pendingChar608 = -1;
+	}
+}
+
+void CaptionEncoder::control608(uint8_t code)
+{
+	// Control codes are doubled so a single corrupted pair is not lost
+	flushChar608();
+	pair608(CC1_MISC, code);
+	pair608(CC1_MISC, code);
+}
+
+void CaptionEncoder::pac608(int row)
+{
+	flushChar608();
+	const PacRow &pac = PAC_ROWS[std::clamp(row, 1, 15)];
+	pair608(pac.first, pac.second | PAC_INDENT_0);
+	pair608(pac.first, pac.second | PAC_INDENT_0);
+}
+
+void CaptionEncoder::text608(const std::string &utf8)
+{
+	const char *p = utf8.data();
+	const char *end = p + utf8.size();
+	int column = 0;
+
+	while (p < end && column < MAX_COLUMNS) {
+		uint32_t cp = utf8_next(p, end);
+
+		const Char608 *ch = nullptr;
+		if (cp < 0x80) {
+			ch = ASCII_608[cp].first ? &ASCII_608[cp] : nullptr;
+		} else {
+			ch = find_codepoint(CHARS_608, cp);
+		}
+		if (!ch) {
+			continue;
+		}
+
+		if (ch->second == 0) {
+			// Basic characters are packed two per pair
+			if (pendingChar608 < 0) {
+				pendingChar608 = ch->first;
+			} else {
+				pair608((uint8_t)pendingChar608, ch->first);
+				pendingChar608 = -1;
+			}
+		} else {
+			// Extended characters overwrite a fallback for older decoders
+			if (ch->fallback) {
+				if (pendingChar608 < 0) {
+					pendingChar608 = ch->fallback;
+				} else {
+					pair608((uint8_t)pendingChar608, ch->fallback);
+					pendingChar608 = -1;
+				}
+			}
+			flushChar608();
+			pair608(ch->first, ch->second);
+		}
+		column++;
+	}
+
+	flushChar608();
+}
+
+void CaptionEncoder::rollUp608(const std::string &line, int rows)
+{
+	static const uint8_t ROLL_UP[] = {RU2, RU3, RU4};
+	uint8_t rollUp = ROLL_UP[std::clamp(rows, 2, 4) - 2];
+
+	// Entering roll-up from pop-on clears the screen in the decoder
+	control608(rollUp);
+	control608(CR);
+	pac608(15);
+	text608(line);
+	mode608 = Mode608::RollUp;
+}
+
+void CaptionEncoder::popOn608(const std::vector<std::string> &lines)
+{
+	int count = std::clamp((int)lines.size(), 1, 15);
+
+	// Build the block off screen, then flip it onto the display
+	control608(RCL);
+	control608(ENM);
+	for (int i = 0; i < count && i < (int)lines.size(); i++) {
+		pac608(15 - count + 1 + i);
+		text608(lines[i]);
+	}
+	control608(EOC);
+	mode608 = Mode608::PopOn;
+}
+
+void CaptionEncoder::clear608()
+{
+	control608(EDM);
+	if (mode608 == Mode608::PopOn) {
+		control608(ENM);
+	}
+}
+
+// ---------------------------------------------------------------------------
+// CEA-708
+
+CaptionEncoder::ServiceState *CaptionEncoder::service708(int service)
+{
+	if (service < 1 || service > MAX_SERVICE) {
+		return nullptr;
+	}
+	return &services[service];
+}
+
+void CaptionEncoder::command708(ServiceState &state, std::initializer_list<uint8_t> bytes)
+{
+	state.data.insert(state.data.end(), bytes.begin(), bytes.end());
+}
+
+void CaptionEncoder::deleteWindows708(ServiceState &state)
+{
+	command708(state, {C1_DLW, 0xFF});
+	state.rollUpDefined = false;
+	state.rollUpRows = 0;
+	state.popOnWindow = -1;
+}
+
+void CaptionEncoder::defineWindow708(ServiceState &state, int window, bool visible, int rows, uint8_t windowStyle)
+{
+	// Anchored at the lower centre, 90% down the safe area, locked to its size
+	const uint8_t anchorVertical = 90;
+	const uint8_t anchorHorizontal = 50;
+
+	command708(state, {
+				  (uint8_t)(C1_DF0 + window),
+				  (uint8_t)((visible ? 0x20 : 0x00) | 0x10 | 0x08),
+				  (uint8_t)(0x80 | anchorVertical),
+				  anchorHorizontal,
+				  (uint8_t)((ANCHOR_LOWER_CENTER << 4) | ((rows - 1) & 0x0F)),
+				  (uint8_t)((MAX_COLUMNS - 1) & 0x3F),
+				  (uint8_t)((windowStyle << 3) | PEN_STYLE_DEFAULT),
+			  });
+}
+
+void CaptionEncoder::text708(ServiceState &state, const std::string &utf8)
+{
+	const char *p = utf8.data();
+	const char *end = p + utf8.size();
+	int column = 0;
+
+	while (p < end && column < MAX_COLUMNS) {
+		uint32_t cp = utf8_next(p, end);
+
+		if ((cp >= 0x20 && cp < 0x7F) || (cp >= 0xA0 && cp <= 0xFF)) {
+			// G0 is ASCII and G1 is Latin-1
+			state.data.push_back((uint8_t)cp);
+		} else if (cp == MUSIC_NOTE) {
+			state.data.push_back(G0_MUSIC_NOTE);
+		} else if (const Char708 *ch = find_codepoint(CHARS_708_G2, cp)) {
+			state.data.push_back(C0_EXT1);
+			state.data.push_back(ch->code);
+		} else {
+			continue;
+		}
+		column++;
+	}
+}
+
+void CaptionEncoder::rollUp708(int service, const std::string &line, int rows)
+{
+	ServiceState *state = service708(service);
+	if (!state) {
+		return;
+	}
+
+	rows = std::clamp(rows, 2, 4);
+	if (!state->rollUpDefined || state->rollUpRows != rows) {
+		if (state->popOnWindow >= 0 || state->rollUpDefined) {
+			deleteWindows708(*state);
+		}
+		// Window 0 becomes current; start writing on its bottom row
+		defineWindow708(*state, 0, true, rows, WINDOW_STYLE_ROLLUP);
+		command708(*state, {C1_SPL, (uint8_t)(rows - 1), 0});
+		state->rollUpDefined = true;
+		state->rollUpRows = rows;
+	}
+
+	// CR on the bottom row scrolls the window up by one row
+	command708(*state, {C0_CR});
+	text708(*state, line);
+}
+
+void CaptionEncoder::popOn708(int service, const std::vector<std::string> &lines)
+{
+	ServiceState *state = service708(service);
+	if (!state) {
+		return;
+	}
+
+	if (state->rollUpDefined) {
+		deleteWindows708(*state);
+	}
+
+	// Alternate between windows 0 and 1 so the new block appears in one step
+	int rows = std::clamp((int)lines.size(), 1, 15);
+	int window = state->popOnWindow == 0 ? 1 : 0;
+	defineWindow708(*state, window, false, rows, WINDOW_STYLE_POPUP);
+	command708(*state, {C1_CLW, (uint8_t)(1 << window)});
+	for (int i = 0; i < rows && i < (int)lines.size(); i++) {
+		command708(*state, {C1_SPL, (uint8_t)i, 0});
+		text708(*state, lines[i]);
+	}
+
+	command708(*state, {C1_DSW, (uint8_t)(1 << window)});
+	if (state->popOnWindow >= 0) {
+		command708(*state, {C1_DLW, (uint8_t)(1 << state->popOnWindow)});
+	}
+	state->popOnWindow = window;
+}
+
+void CaptionEncoder::clear708(int service)
+{
+	ServiceState *state = service708(service);
+	if (!state || (!state->rollUpDefined && state->popOnWindow < 0)) {
+		return;
+	}
+
+	deleteWindows708(*state);
+}
+
+void CaptionEncoder::emitDtvccPacket()
+{
+	if (dtvccPayload.empty()) {
+		return;
+	}
+
+	// Packet size is coded in pairs including the header; a null block pads odd sizes
+	if ((dtvccPayload.size() + 1) & 1) {
+		dtvccPayload.push_back(0x00);
+	}
+	size_t total = dtvccPayload.size() + 1;
+	uint8_t sizeCode = total == 128 ? 0 : (uint8_t)(total / 2);
+	uint8_t header = (uint8_t)((dtvccSequence << 6) | sizeCode);
+	dtvccSequence = (dtvccSequence + 1) & 0x03;
+
+	ccData.push_back(CC_MARKER | CC_VALID | CC_TYPE_DTVCC_START);
+	ccData.push_back(header);
+	ccData.push_back(dtvccPayload[0]);
+	for (size_t i = 1; i < dtvccPayload.size(); i += 2) {
+		ccData.push_back(CC_MARKER | CC_VALID | CC_TYPE_DTVCC_DATA);
+		ccData.push_back(dtvccPayload[i]);
+		ccData.push_back(dtvccPayload[i + 1]);
+	}
+
+	dtvccPayload.clear();
+}
+
+void CaptionEncoder::packDtvcc()
+{
+	for (int service = 1; service <= MAX_SERVICE; service++) {
+		std::vector<uint8_t> &data = services[service].data;
+		size_t headerSize = service < 7 ? 1 : 2;
+
+		// Split into service blocks without cutting a command in half
+		size_t pos = 0;
+		while (pos < data.size()) {
+			size_t end = pos;
+			while (end < data.size()) {
+				size_t len = command_length(data[end]);
+				if (end + len - pos > MAX_SERVICE_BLOCK) {
+					break;
+				}
+				end += len;
+			}
+			end = std::min(end, data.size());
+
+			size_t blockSize = end - pos;
+			if (dtvccPayload.size() + headerSize + blockSize > MAX_DTVCC_PAYLOAD) {
+				emitDtvccPacket();
+			}
+
+			if (service < 7) {
+				dtvccPayload.push_back((uint8_t)((service << 5) | blockSize));
+			} else {
+				dtvccPayload.push_back((uint8_t)((7 << 5) | blockSize));
+				dtvccPayload.push_back((uint8_t)service);
+			}
+			dtvccPayload.insert(dtvccPayload.end(), data.begin() + pos, data.begin() + end);
+			pos = end;
+		}
+
+		data.clear();
+	}
+
+	emitDtvccPacket();
+}
+
+bool CaptionEncoder::finish(std::vector<uint8_t> &data)
+{
+	flushChar608();
+	packDtvcc();
+
+	data.clear();
+	data.swap(ccData);
+	return !data.empty();
+}
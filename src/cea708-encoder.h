@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// Builds CEA-608 (CC1) and CEA-708 (services 1-63) caption data as cc_data
+// triplets ready for obs_output_caption().
+//
+// The encoder keeps per-service window state, so callers only describe what
+// changed: a new roll-up line, a replacement pop-on block or a clear.
+// Commands accumulate until finish() packs them, letting several services
+// share DTVCC packets.
+class CaptionEncoder {
+public:
+	CaptionEncoder();
+
+	// CEA-608 on CC1
+	void rollUp608(const std::string &line, int rows);
+	void popOn608(const std::vector<std::string> &lines);
+	void clear608();
+
+	// CEA-708 on a caption service
+	void rollUp708(int service, const std::string &line, int rows);
+	void popOn708(int service, const std::vector<std::string> &lines);
+	void clear708(int service);
+
+	// Moves everything queued since the last call into data as cc_data
+	// triplets (3 bytes each). Returns false if nothing was queued.
+	bool finish(std::vector<uint8_t> &data);
+
+	// Forget window state, e.g. when a new output starts
+	void reset();
+
+	static constexpr int MAX_SERVICE = 63;
+	static constexpr int MAX_COLUMNS = 32;
+
+private:
+	enum class Mode608 { None, PopOn, RollUp };
+
+	struct ServiceState {
+		bool rollUpDefined = false;
+		int rollUpRows = 0;
+		int popOnWindow = -1;      // Window currently displayed in pop-on mode
+		std::vector<uint8_t> data; // Queued commands and characters
+	};
+
+	// CEA-608 helpers
+	void pair608(uint8_t first, uint8_t second);
+	void control608(uint8_t code);
+	void pac608(int row);
+	void text608(const std::string &utf8);
+	void flushChar608();
+
+	// CEA-708 helpers
+	ServiceState *service708(int service);
+	static void command708(ServiceState &state, std::initializer_list<uint8_t> bytes);
+	static void deleteWindows708(ServiceState &state);
+	static void text708(ServiceState &state, const std::string &utf8);
+	static void defineWindow708(ServiceState &state, int window, bool visible, int rows, uint8_t windowStyle);
+	void packDtvcc();
+	void emitDtvccPacket();
+
+	std::vector<uint8_t> ccData;
+
+	Mode608 mode608;
+	int pendingChar608; // Basic character waiting for a partner byte, -1 if none
+
+	std::array<ServiceState, MAX_SERVICE + 1> services;
+	std::vector<uint8_t> dtvccPayload;
+	uint8_t dtvccSequence;
+};
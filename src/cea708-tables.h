@@ -0,0 +1,345 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Compile-time character and command tables for the CEA-608/708 encoder.
+namespace cea708 {
+
+// cc_data triplet header: marker bits, cc_valid and cc_type
+constexpr uint8_t CC_MARKER = 0xF8;
+constexpr uint8_t CC_VALID = 0x04;
+enum CcType : uint8_t {
+	CC_TYPE_NTSC_FIELD_1 = 0,
+	CC_TYPE_NTSC_FIELD_2 = 1,
+	CC_TYPE_DTVCC_DATA = 2,
+	CC_TYPE_DTVCC_START = 3,
+};
+
+// ---------------------------------------------------------------------------
+// CEA-608
+
+constexpr uint8_t odd_parity(uint8_t byte)
+{
+	uint8_t bits = 0;
+	for (uint8_t b = byte & 0x7F; b; b >>= 1) {
+		bits += b & 1;
+	}
+	return (bits & 1) ? (byte & 0x7F) : (byte | 0x80);
+}
+
+constexpr std::array<uint8_t, 128> make_parity_table()
+{
+	std::array<uint8_t, 128> table{};
+	for (size_t i = 0; i < table.size(); i++) {
+		table[i] = odd_parity((uint8_t)i);
+	}
+	return table;
+}
+
+constexpr std::array<uint8_t, 128> PARITY = make_parity_table();
+
+// Miscellaneous control codes, data channel 1 (CC1), second byte
+constexpr uint8_t CC1_MISC = 0x14;
+enum MiscControl : uint8_t {
+	RCL = 0x20, // Resume caption loading (pop-on)
+	BS = 0x21,  // Backspace
+	RU2 = 0x25, // Roll-up, 2 rows
+	RU3 = 0x26, // Roll-up, 3 rows
+	RU4 = 0x27, // Roll-up, 4 rows
+	RDC = 0x29, // Resume direct captioning (paint-on)
+	EDM = 0x2C, // Erase displayed memory
+	CR = 0x2D,  // Carriage return
+	ENM = 0x2E, // Erase non-displayed memory
+	EOC = 0x2F, // End of caption (flip memories)
+};
+
+// Preamble address codes: first byte and base second byte for rows 1-15
+struct PacRow {
+	uint8_t first;
+	uint8_t second;
+};
+
+constexpr std::array<PacRow, 16> PAC_ROWS = {{
+	{0x00, 0x00}, // Rows are 1-based
+	{0x11, 0x40},
+	{0x11, 0x60},
+	{0x12, 0x40},
+	{0x12, 0x60},
+	{0x15, 0x40},
+	{0x15, 0x60},
+	{0x16, 0x40},
+	{0x16, 0x60},
+	{0x17, 0x40},
+	{0x17, 0x60},
+	{0x10, 0x40},
+	{0x13, 0x40},
+	{0x13, 0x60},
+	{0x14, 0x40},
+	{0x14, 0x60},
+}};
+
+// Indent 0, white: sets the cursor to column 0 of the row
+constexpr uint8_t PAC_INDENT_0 = 0x10;
+
+// A Unicode code point and its CEA-608 representation. Basic characters
+// use a single byte; special (0x11) and extended (0x12/0x13) characters
+// are two-byte codes, and extended ones are preceded by a basic fallback
+// that decoders overwrite with an implicit backspace.
+struct Char608 {
+	uint32_t codepoint;
+	uint8_t first;
+	uint8_t second; // 0 for basic characters
+	uint8_t fallback;
+};
+
+// Characters outside plain ASCII or remapped by the 608 basic set, sorted by code point
+constexpr Char608 CHARS_608[] = {
+	{0x002A, 0x12, 0x28, '.'}, // *
+	{0x005C, 0x13, 0x2B, '/'}, // backslash
+	{0x005E, 0x13, 0x2C, ' '}, // ^
+	{0x005F, 0x13, 0x2D, '-'}, // _
+	{0x0060, 0x12, 0x26, '\''}, // `
+	{0x007B, 0x13, 0x29, '('}, // {
+	{0x007C, 0x13, 0x2E, '!'}, // |
+	{0x007D, 0x13, 0x2A, ')'}, // }
+	{0x007E, 0x13, 0x2F, '-'}, // ~
+	{0x00A1, 0x12, 0x27, '!'}, // ¡
+	{0x00A2, 0x11, 0x35, 0},   // ¢
+	{0x00A3, 0x11, 0x36, 0},   // £
+	{0x00A4, 0x13, 0x36, 'o'}, // ¤
+	{0x00A5, 0x13, 0x35, 'Y'}, // ¥
+	{0x00A9, 0x12, 0x2B, 'c'}, // ©
+	{0x00AB, 0x12, 0x3E, '"'}, // «
+	{0x00AE, 0x11, 0x30, 0},   // ®
+	{0x00B0, 0x11, 0x31, 0},   // °
+	{0x00BB, 0x12, 0x3F, '"'}, // »
+	{0x00BD, 0x11, 0x32, 0},   // ½
+	{0x00BF, 0x11, 0x33, 0},   // ¿
+	{0x00C0, 0x12, 0x30, 'A'}, // À
+	{0x00C1, 0x12, 0x20, 'A'}, // Á
+	{0x00C2, 0x12, 0x31, 'A'}, // Â
+	{0x00C3, 0x13, 0x20, 'A'}, // Ã
+	{0x00C4, 0x13, 0x30, 'A'}, // Ä
+	{0x00C5, 0x13, 0x38, 'A'}, // Å
+	{0x00C7, 0x12, 0x32, 'C'}, // Ç
+	{0x00C8, 0x12, 0x33, 'E'}, // È
+	{0x00C9, 0x12, 0x21, 'E'}, // É
+	{0x00CA, 0x12, 0x34, 'E'}, // Ê
+	{0x00CB, 0x12, 0x35, 'E'}, // Ë
+	{0x00CC, 0x13, 0x23, 'I'}, // Ì
+	{0x00CD, 0x13, 0x22, 'I'}, // Í
+	{0x00CE, 0x12, 0x37, 'I'}, // Î
+	{0x00CF, 0x12, 0x38, 'I'}, // Ï
+	{0x00D1, 0x7D, 0, 0},      // Ñ
+	{0x00D2, 0x13, 0x25, 'O'}, // Ò
+	{0x00D3, 0x12, 0x22, 'O'}, // Ó
+	{0x00D4, 0x12, 0x3A, 'O'}, // Ô
+	{0x00D5, 0x13, 0x27, 'O'}, // Õ
+	{0x00D6, 0x13, 0x32, 'O'}, // Ö
+	{0x00D8, 0x13, 0x3A, 'O'}, // Ø
+	{0x00D9, 0x12, 0x3B, 'U'}, // Ù
+	{0x00DA, 0x12, 0x23, 'U'}, // Ú
+	{0x00DB, 0x12, 0x3D, 'U'}, // Û
+	{0x00DC, 0x12, 0x24, 'U'}, // Ü
+	{0x00DF, 0x13, 0x34, 's'}, // ß
+	{0x00E0, 0x11, 0x38, 0},   // à
+	{0x00E1, 0x2A, 0, 0},      // á
+	{0x00E2, 0x11, 0x3B, 0},   // â
+	{0x00E3, 0x13, 0x21, 'a'}, // ã
+	{0x00E4, 0x13, 0x31, 'a'}, // ä
+	{0x00E5, 0x13, 0x39, 'a'}, // å
+	{0x00E7, 0x7B, 0, 0},      // ç
+	{0x00E8, 0x11, 0x3A, 0},   // è
+	{0x00E9, 0x5C, 0, 0},      // é
+	{0x00EA, 0x11, 0x3C, 0},   // ê
+	{0x00EB, 0x12, 0x36, 'e'}, // ë
+	{0x00EC, 0x13, 0x24, 'i'}, // ì
+	{0x00ED, 0x5E, 0, 0},      // í
+	{0x00EE, 0x11, 0x3D, 0},   // î
+	{0x00EF, 0x12, 0x39, 'i'}, // ï
+	{0x00F1, 0x7E, 0, 0},      // ñ
+	{0x00F2, 0x13, 0x26, 'o'}, // ò
+	{0x00F3, 0x5F, 0, 0},      // ó
+	{0x00F4, 0x11, 0x3E, 0},   // ô
+	{0x00F5, 0x13, 0x28, 'o'}, // õ
+	{0x00F6, 0x13, 0x33, 'o'}, // ö
+	{0x00F7, 0x7C, 0, 0},      // ÷
+	{0x00F8, 0x13, 0x3B, 'o'}, // ø
+	{0x00F9, 0x12, 0x3C, 'u'}, // ù
+	{0x00FA, 0x60, 0, 0},      // ú
+	{0x00FB, 0x11, 0x3F, 0},   // û
+	{0x00FC, 0x12, 0x25, 'u'}, // ü
+	{0x2014, 0x12, 0x2A, '-'}, // —
+	{0x2018, 0x12, 0x26, '\''}, // ‘
+	{0x2019, 0x12, 0x29, '\''}, // ’
+	{0x201C, 0x12, 0x2E, '"'}, // “
+	{0x201D, 0x12, 0x2F, '"'}, // ”
+	{0x2022, 0x12, 0x2D, '.'}, // •
+	{0x2120, 0x12, 0x2C, ' '}, // ℠
+	{0x2122, 0x11, 0x34, 0},   // ™
+	{0x2502, 0x13, 0x37, '!'}, // │
+	{0x250C, 0x13, 0x3C, '+'}, // ┌
+	{0x2510, 0x13, 0x3D, '+'}, // ┐
+	{0x2514, 0x13, 0x3E, '+'}, // └
+	{0x2518, 0x13, 0x3F, '+'}, // ┘
+	{0x2588, 0x7F, 0, 0},      // █
+	{0x266A, 0x11, 0x37, 0},   // ♪
+};
+
+constexpr size_t CHARS_608_COUNT = sizeof(CHARS_608) / sizeof(CHARS_608[0]);
+
+// ASCII lookup generated from the table above: printable ASCII maps to itself
+// unless the 608 basic set reuses the code for an accented letter
+constexpr std::array<Char608, 128> make_ascii_608_table()
+{
+	std::array<Char608, 128> table{};
+	for (uint32_t c = 0x20; c < 0x7F; c++) {
+		table[c] = {c, (uint8_t)c, 0, 0};
+	}
+	for (size_t i = 0; i < CHARS_608_COUNT && CHARS_608[i].codepoint < 0x80; i++) {
+		table[CHARS_608[i].codepoint] = CHARS_608[i];
+	}
+	return table;
+}
+
+constexpr std::array<Char608, 128> ASCII_608 = make_ascii_608_table();
+
+// ---------------------------------------------------------------------------
+// CEA-708
+
+// C0 codes
+enum C0 : uint8_t {
+	C0_NUL = 0x00,
+	C0_ETX = 0x03,
+	C0_BS = 0x08,
+	C0_FF = 0x0C,
+	C0_CR = 0x0D,
+	C0_HCR = 0x0E,
+	C0_EXT1 = 0x10,
+};
+
+// C1 window and pen commands with their parameter byte counts
+enum C1 : uint8_t {
+	C1_CW0 = 0x80, // SetCurrentWindow 0-7
+	C1_CLW = 0x88, // ClearWindows (window bitmap)
+	C1_DSW = 0x89, // DisplayWindows (window bitmap)
+	C1_HDW = 0x8A, // HideWindows (window bitmap)
+	C1_TGW = 0x8B, // ToggleWindows (window bitmap)
+	C1_DLW = 0x8C, // DeleteWindows (window bitmap)
+	C1_DLY = 0x8D, // Delay
+	C1_DLC = 0x8E, // DelayCancel
+	C1_RST = 0x8F, // Reset
+	C1_SPA = 0x90, // SetPenAttributes
+	C1_SPC = 0x91, // SetPenColor
+	C1_SPL = 0x92, // SetPenLocation
+	C1_SWA = 0x97, // SetWindowAttributes
+	C1_DF0 = 0x98, // DefineWindow 0-7
+};
+
+constexpr std::array<uint8_t, 32> make_c1_param_table()
+{
+	std::array<uint8_t, 32> table{};
+	table[C1_CLW - 0x80] = 1;
+	table[C1_DSW - 0x80] = 1;
+	table[C1_HDW - 0x80] = 1;
+	table[C1_TGW - 0x80] = 1;
+	table[C1_DLW - 0x80] = 1;
+	table[C1_DLY - 0x80] = 1;
+	table[C1_SPA - 0x80] = 2;
+	table[C1_SPC - 0x80] = 3;
+	table[C1_SPL - 0x80] = 2;
+	table[C1_SWA - 0x80] = 4;
+	for (int i = 0; i < 8; i++) {
+		table[C1_DF0 - 0x80 + i] = 6;
+	}
+	return table;
+}
+
+constexpr std::array<uint8_t, 32> C1_PARAMS = make_c1_param_table();
+
+// Length in bytes of the command or character starting with code
+constexpr size_t command_length(uint8_t code)
+{
+	if (code < 0x10) {
+		return 1;
+	}
+	if (code < 0x18) {
+		return 2; // EXT1 and one-parameter C0 codes
+	}
+	if (code < 0x20) {
+		return 3; // P16 and two-parameter C0 codes
+	}
+	if (code >= 0x80 && code < 0xA0) {
+		return 1 + C1_PARAMS[code - 0x80];
+	}
+	return 1;
+}
+
+// Service blocks carry at most 31 bytes; DTVCC packets at most 127 after the header
+constexpr size_t MAX_SERVICE_BLOCK = 31;
+constexpr size_t MAX_DTVCC_PAYLOAD = 127;
+
+// Predefined window styles used by DefineWindow
+constexpr uint8_t WINDOW_STYLE_POPUP = 1;
+constexpr uint8_t WINDOW_STYLE_ROLLUP = 4;
+constexpr uint8_t PEN_STYLE_DEFAULT = 1;
+
+// Anchor point 7: lower centre of the window
+constexpr uint8_t ANCHOR_LOWER_CENTER = 7;
+
+// G2 characters reached through EXT1, sorted by code point
+struct Char708 {
+	uint32_t codepoint;
+	uint8_t code;
+};
+
+constexpr Char708 CHARS_708_G2[] = {
+	{0x0152, 0x2C}, // Œ
+	{0x0153, 0x3C}, // œ
+	{0x0160, 0x2A}, // Š
+	{0x0161, 0x3A}, // š
+	{0x0178, 0x3F}, // Ÿ
+	{0x2018, 0x31}, // ‘
+	{0x2019, 0x32}, // ’
+	{0x201C, 0x33}, // “
+	{0x201D, 0x34}, // ”
+	{0x2022, 0x35}, // •
+	{0x2026, 0x25}, // …
+	{0x2120, 0x3D}, // ℠
+	{0x2122, 0x39}, // ™
+	{0x215B, 0x76}, // ⅛
+	{0x215C, 0x77}, // ⅜
+	{0x215D, 0x78}, // ⅝
+	{0x215E, 0x79}, // ⅞
+	{0x2500, 0x7D}, // ─
+	{0x2502, 0x7A}, // │
+	{0x250C, 0x7F}, // ┌
+	{0x2510, 0x7B}, // ┐
+	{0x2514, 0x7C}, // └
+	{0x2518, 0x7E}, // ┘
+	{0x2588, 0x30}, // █
+};
+
+constexpr size_t CHARS_708_G2_COUNT = sizeof(CHARS_708_G2) / sizeof(CHARS_708_G2[0]);
+
+// G0 0x7F is the music note rather than DEL
+constexpr uint32_t MUSIC_NOTE = 0x266A;
+constexpr uint8_t G0_MUSIC_NOTE = 0x7F;
+
+template<typename T, size_t N> constexpr bool sorted_by_codepoint(const T (&table)[N])
+{
+	for (size_t i = 1; i < N; i++) {
+		if (table[i - 1].codepoint >= table[i].codepoint) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static_assert(sorted_by_codepoint(CHARS_608), "CHARS_608 must be sorted for binary search");
+static_assert(sorted_by_codepoint(CHARS_708_G2), "CHARS_708_G2 must be sorted for binary search");
+static_assert(PARITY['A'] == 0xC1 && PARITY['I'] == 0x49 && PARITY[0x14] == 0x94, "608 parity table");
+
+} // namespace cea708
@@ -1,6 +1,4 @@
 #include "entei-dialog.h"
-#include "websocket-client.h"
-#include "cJSON.h"
 #include <obs-module.h>
 #include <obs-frontend-api.h>
 #include <util/config-file.h>
@@ -13,24 +11,80 @@
 #include <QtWidgets/QLineEdit>
 #include <QtWidgets/QPushButton>
 #include <QtWidgets/QTextEdit>
+#include <QtWidgets/QPlainTextEdit>
 #include <QtWidgets/QGroupBox>
 #include <QtWidgets/QCheckBox>
+#include <QtWidgets/QSpinBox>
+#include <QtWidgets/QComboBox>
 #include <QtCore/QDateTime>
-#include <QtCore/QMutableMapIterator>
+#include <QtCore/QSignalBlocker>
+#include <QtCore/QStringList>
 #include <QtGui/QCloseEvent>
 #include <QtGui/QShowEvent>
+#include <algorithm>
 #include <chrono>
 #include <functional>
+#include <set>
+
+// Parsing and composition are light; two workers keep extra languages cheap
+static const size_t CAPTION_WORKER_THREADS = 2;
+
+// Default minimum time between two caption sends on the same track
+static const int DEFAULT_MIN_CAPTION_INTERVAL_MS = 200;
+
+static bool enum_audio_source(void *param, obs_source_t *source)
+{
+	if (obs_source_get_output_flags(source) & OBS_SOURCE_AUDIO) {
+		static_cast<QStringList *>(param)->append(QString::fromUtf8(obs_source_get_name(source)));
+	}
+	return true;
+}
+
+static bool validate_transcription_url(const QString &url, QString &error)
+{
+	if (url.isEmpty()) {
+		error = "Transcription URL is empty";
+		return false;
+	}
+
+	// Check for extremely long URLs that could cause buffer overflows
+	if (url.length() > 2048) {
+		error = "URL is too long";
+		return false;
+	}
+
+	// WebSocket servers, or an in-process model when built with one
+	std::string reason;
+	if (!TranscriptionBackend::supportsUrl(url.toStdString(), reason)) {
+		error = QString::fromStdString(reason);
+		return false;
+	}
+
+	return true;
+}
 
 EnteiToolsDialog::EnteiToolsDialog(QWidget *parent)
 	: QDialog(parent),
-	  client(nullptr),
+	  additionalTracksEdit(nullptr),
+	  latencyLabel(nullptr),
+	  minIntervalSpinBox(nullptr),
+	  readingRateSpinBox(nullptr),
+	  captionModeComboBox(nullptr),
+	  captionEncoderComboBox(nullptr),
+	  audioSourceComboBox(nullptr),
+	  additionalAudioSourcesEdit(nullptr),
+	  audioFrameSpinBox(nullptr),
+	  audioFramesPerMessageSpinBox(nullptr),
+	  audioEncodingComboBox(nullptr),
+	  voiceGatingCheckBox(nullptr),
+	  vadHangoverSpinBox(nullptr),
+	  metricsPortSpinBox(nullptr),
 	  isConnected(false),
-	  channel_joined(false),
 	  heartbeatTimer(nullptr),
-	  captionTimer(nullptr),
-	  streamingActive(false),
-	  lastCaptionSentTime(0)
+	  flightRecorder(workerPool),
+	  audioUplink(metrics),
+	  metricsServer(metrics),
+	  workerPool(CAPTION_WORKER_THREADS)
 {
 	setWindowTitle("Entei Caption Provider");
 	setModal(false);
@@ -42,10 +96,11 @@ EnteiToolsDialog::EnteiToolsDialog(QWidget *parent)
 	heartbeatTimer->setInterval(30000); // 30 seconds
 	connect(heartbeatTimer, &QTimer::timeout, this, &EnteiToolsDialog::sendPing);
 
-	// Setup caption timer for continuous stream
-	captionTimer = new QTimer(this);
-	captionTimer->setInterval(1500); // 1.5 seconds
-	connect(captionTimer, &QTimer::timeout, this, &EnteiToolsDialog::onCaptionTimer);
+	// Captions go out on the video tick; the UI only refreshes the statistics
+	captionEmitter.setEmitHandler([this]() {
+		QMetaObject::invokeMethod(this, [this]() { updateLatencyStatus(); }, Qt::QueuedConnection);
+	});
+	captionEmitter.start();
 
 	// Register for OBS frontend events for auto-connect
 	obs_frontend_add_event_callback(obs_frontend_event_callback, this);
@@ -55,6 +110,7 @@ EnteiToolsDialog::EnteiToolsDialog(QWidget *parent)
 	if (websocketUrlEdit && autoConnectCheckBox) {
 		loadSettings();
 	}
+	captionEmitter.setNativeEncoder(useNativeEncoder());
 }
 
 EnteiToolsDialog::~EnteiToolsDialog()
@@ -63,17 +119,18 @@ EnteiToolsDialog::~EnteiToolsDialog()
 	if (heartbeatTimer) {
 		heartbeatTimer->stop();
 	}
-	if (captionTimer) {
-		captionTimer->stop();
-	}
+
+	// No tick may run once destruction starts; output signals are disconnected with the registry
+	captionEmitter.stop();
+	captionEmitter.clear();
+
+	// Stop tapping audio before the tracks it streams to are destroyed
+	audioUplink.setSources({});
 
 	// Unregister from OBS frontend events
 	obs_frontend_remove_event_callback(obs_frontend_event_callback, this);
 
-	if (client) {
-		websocket_client_destroy(client);
-		client = nullptr;
-	}
+	destroyTracks();
 }
 
 void EnteiToolsDialog::closeEvent(QCloseEvent *event)
@@ -110,11 +167,35 @@ void EnteiToolsDialog::setupUI()
 
 	websocketUrlEdit = new QLineEdit(this);
 	websocketUrlEdit->setPlaceholderText("ws://saya:7175/ws/captions");
+	websocketUrlEdit->setToolTip("Transcription server, or whisper://<model file> to transcribe in OBS when built "
+				     "with whisper.cpp");
 	connectionLayout->addWidget(websocketUrlEdit, 0, 1);
 
+	QLabel *tracksLabel = new QLabel("Tracks:", this);
+	tracksLabel->setAlignment(Qt::AlignRight | Qt::AlignTop);
+	connectionLayout->addWidget(tracksLabel, 1, 0);
+
+	// Additional language feeds, one "<service> <url>" per line (service 1 is the URL above)
+	additionalTracksEdit = new QPlainTextEdit(this);
+	additionalTracksEdit->setPlaceholderText("2 ws://saya:7175/ws/captions?lang=es");
+	additionalTracksEdit->setMaximumHeight(60);
+	connectionLayout->addWidget(additionalTracksEdit, 1, 1);
+
 	autoConnectCheckBox = new QCheckBox("Auto-start captions when streaming begins", this);
 	connectionLayout->addWidget(autoConnectCheckBox, 2, 0, 1, 2);
 
+	QLabel *metricsPortLabel = new QLabel("Metrics port:", this);
+	metricsPortLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	connectionLayout->addWidget(metricsPortLabel, 3, 0);
+
+	metricsPortSpinBox = new QSpinBox(this);
+	metricsPortSpinBox->setRange(0, 65535);
+	metricsPortSpinBox->setSpecialValueText("Off");
+	metricsPortSpinBox->setValue(0);
+	metricsPortSpinBox->setToolTip("Serves Prometheus metrics at http://127.0.0.1:<port>/metrics while a "
+				       "WebSocket primary track is running");
+	connectionLayout->addWidget(metricsPortSpinBox, 3, 1);
+
 	mainLayout->addWidget(connectionGroup);
 
 	// Status Group
@@ -125,8 +206,144 @@ void EnteiToolsDialog::setupUI()
 	statusLabel->setStyleSheet("QLabel { font-weight: bold; }");
 	statusLayout->addWidget(statusLabel);
 
+	latencyLabel = new QLabel(this);
+	latencyLabel->setVisible(false);
+	statusLayout->addWidget(latencyLabel);
+
 	mainLayout->addWidget(statusGroup);
 
+	// Caption Settings Group
+	QGroupBox *captionGroup = new QGroupBox("Captions", this);
+	QGridLayout *captionLayout = new QGridLayout(captionGroup);
+	captionLayout->setColumnStretch(1, 1);
+
+	QLabel *minIntervalLabel = new QLabel("Minimum interval:", this);
+	minIntervalLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	captionLayout->addWidget(minIntervalLabel, 0, 0);
+
+	minIntervalSpinBox = new QSpinBox(this);
+	minIntervalSpinBox->setRange(0, 5000);
+	minIntervalSpinBox->setSingleStep(50);
+	minIntervalSpinBox->setSuffix(" ms");
+	minIntervalSpinBox->setValue(DEFAULT_MIN_CAPTION_INTERVAL_MS);
+	minIntervalSpinBox->setToolTip("Shortest time between two caption updates sent to OBS");
+	captionLayout->addWidget(minIntervalSpinBox, 0, 1);
+
+	QLabel *modeLabel = new QLabel("Mode:", this);
+	modeLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	captionLayout->addWidget(modeLabel, 1, 0);
+
+	captionModeComboBox = new QComboBox(this);
+	captionModeComboBox->addItem("Pop-on (replace block)", "popon");
+	captionModeComboBox->addItem("Roll-up (append lines)", "rollup");
+	captionModeComboBox->setToolTip("Roll-up only sends completed lines and lets earlier lines scroll");
+	captionLayout->addWidget(captionModeComboBox, 1, 1);
+
+	QLabel *encoderLabel = new QLabel("Encoder:", this);
+	encoderLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	captionLayout->addWidget(encoderLabel, 2, 0);
+
+	captionEncoderComboBox = new QComboBox(this);
+	captionEncoderComboBox->addItem("OBS caption text", "text");
+	captionEncoderComboBox->addItem("Native CEA-608/708", "native");
+	captionEncoderComboBox->setToolTip(
+		"Native encoding sends every track on its own CEA-708 service, with CC1 for the primary track");
+	captionLayout->addWidget(captionEncoderComboBox, 2, 1);
+
+	QLabel *readingRateLabel = new QLabel("Reading rate:", this);
+	readingRateLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	captionLayout->addWidget(readingRateLabel, 3, 0);
+
+	readingRateSpinBox = new QSpinBox(this);
+	readingRateSpinBox->setRange(60, 400);
+	readingRateSpinBox->setSingleStep(10);
+	readingRateSpinBox->setSuffix(" wpm");
+	readingRateSpinBox->setValue(CaptionPipeline::DEFAULT_READING_RATE_WPM);
+	readingRateSpinBox->setToolTip("Captions stay on screen long enough to be read at this speed");
+	captionLayout->addWidget(readingRateSpinBox, 3, 1);
+
+	mainLayout->addWidget(captionGroup);
+
+	// Audio Uplink Group
+	QGroupBox *audioGroup = new QGroupBox("Audio Uplink", this);
+	QGridLayout *audioLayout = new QGridLayout(audioGroup);
+	audioLayout->setColumnStretch(1, 1);
+
+	QLabel *audioSourceLabel = new QLabel("Source:", this);
+	audioSourceLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	audioLayout->addWidget(audioSourceLabel, 0, 0);
+
+	audioSourceComboBox = new QComboBox(this);
+	audioSourceComboBox->addItem("None (text only)", QString());
+	audioSourceComboBox->setToolTip("Streams this source's audio to the transcription server on the primary URL");
+	audioLayout->addWidget(audioSourceComboBox, 0, 1);
+
+	QLabel *audioSourcesLabel = new QLabel("More sources:", this);
+	audioSourcesLabel->setAlignment(Qt::AlignRight | Qt::AlignTop);
+	audioLayout->addWidget(audioSourcesLabel, 1, 0);
+
+	// Further speakers, one "<tag> <source name>" per line, each streamed on its own
+	additionalAudioSourcesEdit = new QPlainTextEdit(this);
+	additionalAudioSourcesEdit->setPlaceholderText("guest Guest Mic");
+	additionalAudioSourcesEdit->setMaximumHeight(60);
+	additionalAudioSourcesEdit->setToolTip("Tagged sources streamed alongside the one above, so captions can mark "
+					       "speaker changes; applied on Connect");
+	audioLayout->addWidget(additionalAudioSourcesEdit, 1, 1);
+
+	QLabel *audioFrameLabel = new QLabel("Frame size:", this);
+	audioFrameLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	audioLayout->addWidget(audioFrameLabel, 2, 0);
+
+	audioFrameSpinBox = new QSpinBox(this);
+	audioFrameSpinBox->setRange(10, 100);
+	audioFrameSpinBox->setSingleStep(10);
+	audioFrameSpinBox->setSuffix(" ms");
+	audioFrameSpinBox->setValue(AudioUplink::DEFAULT_FRAME_MS);
+	audioFrameSpinBox->setToolTip("Audio carried by each frame");
+	audioLayout->addWidget(audioFrameSpinBox, 2, 1);
+
+	QLabel *audioBatchLabel = new QLabel("Frames per message:", this);
+	audioBatchLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	audioLayout->addWidget(audioBatchLabel, 3, 0);
+
+	audioFramesPerMessageSpinBox = new QSpinBox(this);
+	audioFramesPerMessageSpinBox->setRange(1, 10);
+	audioFramesPerMessageSpinBox->setValue(AudioUplink::DEFAULT_FRAMES_PER_MESSAGE);
+	audioFramesPerMessageSpinBox->setToolTip(
+		"Fewer frames per message lower latency, more cut per-message overhead");
+	audioLayout->addWidget(audioFramesPerMessageSpinBox, 3, 1);
+
+	QLabel *audioEncodingLabel = new QLabel("Encoding:", this);
+	audioEncodingLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	audioLayout->addWidget(audioEncodingLabel, 4, 0);
+
+	audioEncodingComboBox = new QComboBox(this);
+	audioEncodingComboBox->addItem("PCM 16-bit (256 kbit/s)", "pcm");
+	if (AudioEncoder::opusAvailable()) {
+		audioEncodingComboBox->addItem(
+			QString("Opus (%1 kbit/s)").arg(AudioEncoder::OPUS_BITRATE / 1000), "opus");
+	}
+	audioEncodingComboBox->setToolTip("Opus suits servers across a WAN link; it is encoded on the network thread");
+	audioLayout->addWidget(audioEncodingComboBox, 4, 1);
+
+	voiceGatingCheckBox = new QCheckBox("Only send speech", this);
+	voiceGatingCheckBox->setToolTip("Holds back silence and marks where speech starts and ends");
+	audioLayout->addWidget(voiceGatingCheckBox, 5, 1);
+
+	QLabel *hangoverLabel = new QLabel("Speech hangover:", this);
+	hangoverLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	audioLayout->addWidget(hangoverLabel, 6, 0);
+
+	vadHangoverSpinBox = new QSpinBox(this);
+	vadHangoverSpinBox->setRange(0, 2000);
+	vadHangoverSpinBox->setSingleStep(50);
+	vadHangoverSpinBox->setSuffix(" ms");
+	vadHangoverSpinBox->setValue(VoiceActivityDetector::DEFAULT_HANGOVER_MS);
+	vadHangoverSpinBox->setToolTip("Silence allowed inside an utterance before it is closed");
+	audioLayout->addWidget(vadHangoverSpinBox, 6, 1);
+
+	mainLayout->addWidget(audioGroup);
+
 	// Control Buttons
 	QHBoxLayout *buttonLayout = new QHBoxLayout();
 
@@ -163,6 +380,27 @@ void EnteiToolsDialog::setupUI()
 	connect(websocketUrlEdit, &QLineEdit::textChanged, this, &EnteiToolsDialog::onWebSocketUrlChanged);
 	// Channel is saved when dialog closes, no need for auto-save on each keystroke
 	connect(autoConnectCheckBox, &QCheckBox::toggled, this, &EnteiToolsDialog::onAutoConnectToggled);
+	connect(minIntervalSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this,
+		&EnteiToolsDialog::onMinIntervalChanged);
+	connect(readingRateSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this,
+		&EnteiToolsDialog::onReadingRateChanged);
+	connect(captionModeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+		&EnteiToolsDialog::onCaptionModeChanged);
+	connect(captionEncoderComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+		&EnteiToolsDialog::onCaptionEncoderChanged);
+	connect(audioSourceComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+		&EnteiToolsDialog::onAudioSourceChanged);
+	connect(audioFrameSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this,
+		&EnteiToolsDialog::onAudioFramingChanged);
+	connect(audioFramesPerMessageSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this,
+		&EnteiToolsDialog::onAudioFramingChanged);
+	connect(audioEncodingComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+		&EnteiToolsDialog::onAudioEncodingChanged);
+	connect(voiceGatingCheckBox, &QCheckBox::toggled, this, &EnteiToolsDialog::onVoiceGatingChanged);
+	connect(vadHangoverSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this,
+		&EnteiToolsDialog::onVoiceGatingChanged);
+	// Not valueChanged: typing a port would try to bind each prefix of it on the way
+	connect(metricsPortSpinBox, &QSpinBox::editingFinished, this, &EnteiToolsDialog::onMetricsPortEdited);
 
 	// Initial state
 	updateConnectionStatus(false);
@@ -196,6 +434,76 @@ void EnteiToolsDialog::loadSettings()
 	bool autoConnect = config_get_bool(config, "EnteiCaptionProvider", "AutoConnect");
 	autoConnectCheckBox->setChecked(autoConnect);
 
+	config_set_default_int(config, "EnteiCaptionProvider", "MinCaptionInterval", DEFAULT_MIN_CAPTION_INTERVAL_MS);
+	if (minIntervalSpinBox) {
+		minIntervalSpinBox->setValue((int)config_get_int(config, "EnteiCaptionProvider", "MinCaptionInterval"));
+	}
+
+	config_set_default_int(config, "EnteiCaptionProvider", "ReadingRate",
+			       CaptionPipeline::DEFAULT_READING_RATE_WPM);
+	if (readingRateSpinBox) {
+		readingRateSpinBox->setValue((int)config_get_int(config, "EnteiCaptionProvider", "ReadingRate"));
+	}
+
+	config_set_default_string(config, "EnteiCaptionProvider", "CaptionMode", "popon");
+	if (captionModeComboBox) {
+		int index = captionModeComboBox->findData(
+			QString::fromUtf8(config_get_string(config, "EnteiCaptionProvider", "CaptionMode")));
+		captionModeComboBox->setCurrentIndex(index >= 0 ? index : 0);
+	}
+
+	config_set_default_string(config, "EnteiCaptionProvider", "CaptionEncoder", "text");
+	if (captionEncoderComboBox) {
+		int index = captionEncoderComboBox->findData(
+			QString::fromUtf8(config_get_string(config, "EnteiCaptionProvider", "CaptionEncoder")));
+		captionEncoderComboBox->setCurrentIndex(index >= 0 ? index : 0);
+	}
+
+	config_set_default_int(config, "EnteiCaptionProvider", "AudioFrameMs", AudioUplink::DEFAULT_FRAME_MS);
+	config_set_default_int(config, "EnteiCaptionProvider", "AudioFramesPerMessage",
+			       AudioUplink::DEFAULT_FRAMES_PER_MESSAGE);
+	if (audioFrameSpinBox && audioFramesPerMessageSpinBox) {
+		audioFrameSpinBox->setValue((int)config_get_int(config, "EnteiCaptionProvider", "AudioFrameMs"));
+		audioFramesPerMessageSpinBox->setValue(
+			(int)config_get_int(config, "EnteiCaptionProvider", "AudioFramesPerMessage"));
+		audioUplink.setFraming(audioFrameSpinBox->value(), audioFramesPerMessageSpinBox->value());
+	}
+
+	config_set_default_string(config, "EnteiCaptionProvider", "AudioEncoding", "pcm");
+	if (audioEncodingComboBox) {
+		int index = audioEncodingComboBox->findData(
+			QString::fromUtf8(config_get_string(config, "EnteiCaptionProvider", "AudioEncoding")));
+		audioEncodingComboBox->setCurrentIndex(index >= 0 ? index : 0);
+		onAudioEncodingChanged(audioEncodingComboBox->currentIndex());
+	}
+
+	config_set_default_bool(config, "EnteiCaptionProvider", "AudioVoiceGating", false);
+	config_set_default_int(config, "EnteiCaptionProvider", "AudioVadHangover",
+			       VoiceActivityDetector::DEFAULT_HANGOVER_MS);
+	if (voiceGatingCheckBox && vadHangoverSpinBox) {
+		voiceGatingCheckBox->setChecked(config_get_bool(config, "EnteiCaptionProvider", "AudioVoiceGating"));
+		vadHangoverSpinBox->setValue((int)config_get_int(config, "EnteiCaptionProvider", "AudioVadHangover"));
+		onVoiceGatingChanged();
+	}
+
+	const char *audioSources = config_get_string(config, "EnteiCaptionProvider", "AdditionalAudioSources");
+	if (additionalAudioSourcesEdit) {
+		additionalAudioSourcesEdit->setPlainText(audioSources ? QString::fromUtf8(audioSources) : QString());
+	}
+
+	const char *audioSource = config_get_string(config, "EnteiCaptionProvider", "AudioSource");
+	populateAudioSources(audioSource ? QString::fromUtf8(audioSource) : QString());
+
+	const char *additionalTracks = config_get_string(config, "EnteiCaptionProvider", "AdditionalTracks");
+	if (additionalTracksEdit) {
+		additionalTracksEdit->setPlainText(additionalTracks ? QString::fromUtf8(additionalTracks) : QString());
+	}
+
+	config_set_default_int(config, "EnteiCaptionProvider", "MetricsPort", 0);
+	if (metricsPortSpinBox) {
+		metricsPortSpinBox->setValue((int)config_get_int(config, "EnteiCaptionProvider", "MetricsPort"));
+	}
+
 	// Restore window geometry with error handling
 	const char *geometryStr = config_get_string(config, "EnteiCaptionProvider", "DialogGeometry");
 	if (geometryStr && strlen(geometryStr) > 0) {
@@ -240,6 +548,48 @@ void EnteiToolsDialog::saveSettings()
 	std::string urlStdString = websocketUrlEdit->text().toStdString();
 	config_set_string(config, "EnteiCaptionProvider", "WebSocketUrl", urlStdString.c_str());
 	config_set_bool(config, "EnteiCaptionProvider", "AutoConnect", autoConnectCheckBox->isChecked());
+	if (minIntervalSpinBox) {
+		config_set_int(config, "EnteiCaptionProvider", "MinCaptionInterval", minIntervalSpinBox->value());
+	}
+	if (readingRateSpinBox) {
+		config_set_int(config, "EnteiCaptionProvider", "ReadingRate", readingRateSpinBox->value());
+	}
+	if (captionModeComboBox) {
+		std::string modeStdString = captionModeComboBox->currentData().toString().toStdString();
+		config_set_string(config, "EnteiCaptionProvider", "CaptionMode", modeStdString.c_str());
+	}
+	if (captionEncoderComboBox) {
+		std::string encoderStdString = captionEncoderComboBox->currentData().toString().toStdString();
+		config_set_string(config, "EnteiCaptionProvider", "CaptionEncoder", encoderStdString.c_str());
+	}
+	if (audioSourceComboBox) {
+		std::string sourceStdString = audioSourceComboBox->currentData().toString().toStdString();
+		config_set_string(config, "EnteiCaptionProvider", "AudioSource", sourceStdString.c_str());
+	}
+	if (additionalAudioSourcesEdit) {
+		std::string sourcesStdString = additionalAudioSourcesEdit->toPlainText().toStdString();
+		config_set_string(config, "EnteiCaptionProvider", "AdditionalAudioSources", sourcesStdString.c_str());
+	}
+	if (audioFrameSpinBox && audioFramesPerMessageSpinBox) {
+		config_set_int(config, "EnteiCaptionProvider", "AudioFrameMs", audioFrameSpinBox->value());
+		config_set_int(config, "EnteiCaptionProvider", "AudioFramesPerMessage",
+			       audioFramesPerMessageSpinBox->value());
+	}
+	if (audioEncodingComboBox) {
+		std::string encodingStdString = audioEncodingComboBox->currentData().toString().toStdString();
+		config_set_string(config, "EnteiCaptionProvider", "AudioEncoding", encodingStdString.c_str());
+	}
+	if (voiceGatingCheckBox && vadHangoverSpinBox) {
+		config_set_bool(config, "EnteiCaptionProvider", "AudioVoiceGating", voiceGatingCheckBox->isChecked());
+		config_set_int(config, "EnteiCaptionProvider", "AudioVadHangover", vadHangoverSpinBox->value());
+	}
+	if (additionalTracksEdit) {
+		std::string tracksStdString = additionalTracksEdit->toPlainText().toStdString();
+		config_set_string(config, "EnteiCaptionProvider", "AdditionalTracks", tracksStdString.c_str());
+	}
+	if (metricsPortSpinBox) {
+		config_set_int(config, "EnteiCaptionProvider", "MetricsPort", metricsPortSpinBox->value());
+	}
 
 	// Save window geometry
 	QByteArray geometry = saveGeometry();
@@ -252,49 +602,32 @@ void EnteiToolsDialog::saveSettings()
 void EnteiToolsDialog::onConnectClicked()
 {
 	QString url = websocketUrlEdit->text().trimmed();
-	if (url.isEmpty()) {
-		logTextEdit->append("Error: WebSocket URL is empty");
-		return;
-	}
-
-	// Basic URL validation to prevent crashes
-	if (!url.startsWith("ws://") && !url.startsWith("wss://")) {
-		logTextEdit->append("Error: URL must start with ws:// or wss://");
-		return;
-	}
-
-	// Check for extremely long URLs that could cause buffer overflows
-	if (url.length() > 2048) {
-		logTextEdit->append("Error: URL is too long");
+	QString error;
+	if (!validate_transcription_url(url, error)) {
+		logTextEdit->append(QString("Error: %1").arg(error));
 		return;
 	}
 
-	if (client) {
-		websocket_client_destroy(client);
-		client = nullptr;
-	}
-
-	client = websocket_client_create(url.toUtf8().constData());
-	if (!client) {
-		logTextEdit->append("Error: Failed to create WebSocket client");
-		return;
-	}
+	applyAudioSources();
+	createTracks(url);
 
-	websocket_client_set_connect_callback(client, websocket_connect_callback, this);
-	websocket_client_set_message_callback(client, websocket_message_callback, this);
-
-	if (websocket_client_connect(client)) {
-		logTextEdit->append(QString("Connecting to %1...").arg(url));
-		connectButton->setEnabled(false);
-	} else {
-		logTextEdit->append("Error: Failed to initiate connection");
+	for (const auto &track : tracks) {
+		if (track->connect()) {
+			logTextEdit->append(QString("Connecting to %1...").arg(track->url()));
+			if (track.get() == primaryTrack()) {
+				connectButton->setEnabled(false);
+			}
+		}
 	}
+	startMetricsServer();
 }
 
 void EnteiToolsDialog::onDisconnectClicked()
 {
-	if (client) {
-		websocket_client_disconnect(client);
+	if (!tracks.empty()) {
+		for (const auto &track : tracks) {
+			track->disconnect();
+		}
 		logTextEdit->append("Disconnecting...");
 	}
 
@@ -302,9 +635,6 @@ void EnteiToolsDialog::onDisconnectClicked()
 	if (heartbeatTimer) {
 		heartbeatTimer->stop();
 	}
-	if (captionTimer) {
-		captionTimer->stop();
-	}
 }
 
 void EnteiToolsDialog::onWebSocketUrlChanged()
@@ -332,9 +662,169 @@ void EnteiToolsDialog::onAutoConnectToggled(bool enabled)
 	updateConnectionStatus(isConnected);
 }
 
+void EnteiToolsDialog::onMinIntervalChanged(int interval)
+{
+	for (const auto &track : tracks) {
+		track->setMinInterval(interval);
+	}
+}
+
+void EnteiToolsDialog::onReadingRateChanged(int wordsPerMinute)
+{
+	for (const auto &track : tracks) {
+		track->setReadingRate(wordsPerMinute);
+	}
+}
+
+void EnteiToolsDialog::onCaptionModeChanged(int index)
+{
+	Q_UNUSED(index);
+
+	CaptionPipeline::Mode mode = selectedCaptionMode();
+	for (const auto &track : tracks) {
+		track->setMode(mode);
+	}
+}
+
+void EnteiToolsDialog::onCaptionEncoderChanged(int index)
+{
+	Q_UNUSED(index);
+
+	captionEmitter.setNativeEncoder(useNativeEncoder());
+}
+
+void EnteiToolsDialog::onAudioSourceChanged(int index)
+{
+	Q_UNUSED(index);
+
+	applyAudioSources();
+}
+
+void EnteiToolsDialog::applyAudioSources()
+{
+	std::vector<AudioUplink::Source> sources;
+	QString primary = audioSourceComboBox->currentData().toString();
+	if (!primary.isEmpty()) {
+		sources.push_back({primary.toStdString(), std::string()});
+	}
+
+	if (additionalAudioSourcesEdit) {
+		const QStringList lines = additionalAudioSourcesEdit->toPlainText().split('\n', Qt::SkipEmptyParts);
+		for (const QString &line : lines) {
+			// Source names may contain spaces, tags may not
+			QString trimmed = line.trimmed();
+			qsizetype space = trimmed.indexOf(' ');
+			QString name = space > 0 ? trimmed.mid(space + 1).trimmed() : QString();
+			if (name.isEmpty()) {
+				logTextEdit->append(QString("Ignoring audio source line \"%1\"").arg(trimmed));
+				continue;
+			}
+			sources.push_back({name.toStdString(), trimmed.left(space).toStdString()});
+		}
+	}
+
+	audioUplink.setSources(sources);
+}
+
+void EnteiToolsDialog::onAudioFramingChanged(int value)
+{
+	Q_UNUSED(value);
+
+	audioUplink.setFraming(audioFrameSpinBox->value(), audioFramesPerMessageSpinBox->value());
+}
+
+void EnteiToolsDialog::onAudioEncodingChanged(int index)
+{
+	bool opus = audioEncodingComboBox->itemData(index).toString() == "opus";
+	audioUplink.setEncoding(opus ? AudioEncoder::Format::Opus : AudioEncoder::Format::Pcm);
+}
+
+void EnteiToolsDialog::onMetricsPortEdited()
+{
+	// Also emitted when the box merely loses focus
+	if (metricsPortSpinBox->value() == metricsServer.port()) {
+		return;
+	}
+	startMetricsServer();
+}
+
+void EnteiToolsDialog::startMetricsServer()
+{
+	// Without tracks there is no network thread yet; connecting calls this again
+	int port = metricsPortSpinBox ? metricsPortSpinBox->value() : 0;
+	if (port <= 0 || tracks.empty()) {
+		metricsServer.stop();
+		return;
+	}
+
+	CaptionTrack *track = primaryTrack();
+	asio::io_context *context = track && track->backend() ? track->backend()->networkContext() : nullptr;
+	if (!context) {
+		metricsServer.stop();
+		logTextEdit->append("Metrics endpoint needs a WebSocket primary track; not serving metrics");
+		return;
+	}
+
+	std::string error;
+	if (!metricsServer.start(*context, (uint16_t)port, error)) {
+		logTextEdit->append(
+			QString("Failed to serve metrics on port %1: %2").arg(port).arg(QString::fromStdString(error)));
+		return;
+	}
+	logTextEdit->append(QString("Serving metrics at http://127.0.0.1:%1/metrics").arg(port));
+}
+
+void EnteiToolsDialog::onVoiceGatingChanged()
+{
+	vadHangoverSpinBox->setEnabled(voiceGatingCheckBox->isChecked());
+	audioUplink.setVoiceGating(voiceGatingCheckBox->isChecked(), vadHangoverSpinBox->value());
+}
+
+void EnteiToolsDialog::populateAudioSources(const QString &selected)
+{
+	if (!audioSourceComboBox) {
+		return;
+	}
+
+	QStringList names;
+	obs_enum_sources(enum_audio_source, &names);
+	names.sort(Qt::CaseInsensitive);
+	// Keep a saved source that is not loaded yet, so it is picked up once it is
+	if (!selected.isEmpty() && !names.contains(selected)) {
+		names.append(selected);
+	}
+
+	{
+		QSignalBlocker blocker(audioSourceComboBox);
+		while (audioSourceComboBox->count() > 1) {
+			audioSourceComboBox->removeItem(1);
+		}
+		for (const QString &name : names) {
+			audioSourceComboBox->addItem(name, name);
+		}
+		int index = audioSourceComboBox->findData(selected);
+		audioSourceComboBox->setCurrentIndex(index >= 0 ? index : 0);
+	}
+	onAudioSourceChanged(audioSourceComboBox->currentIndex());
+}
+
+CaptionPipeline::Mode EnteiToolsDialog::selectedCaptionMode() const
+{
+	if (captionModeComboBox && captionModeComboBox->currentData().toString() == "rollup") {
+		return CaptionPipeline::Mode::RollUp;
+	}
+	return CaptionPipeline::Mode::PopOn;
+}
+
+bool EnteiToolsDialog::useNativeEncoder() const
+{
+	return captionEncoderComboBox && captionEncoderComboBox->currentData().toString() == "native";
+}
+
 void EnteiToolsDialog::updateConnectionStatus(bool connected)
 {
 	isConnected = connected;
+	updateCaptionEmitter();
 
 	if (connected) {
 		statusLabel->setText("Connected - Captions Active");
@@ -356,6 +846,14 @@ void EnteiToolsDialog::updateConnectionStatus(bool connected)
 	}
 }
 
+void EnteiToolsDialog::updateCaptionEmitter()
+{
+	// Each service has its own feed, so captions keep flowing while any track is up;
+	// the status label follows the primary track alone
+	captionEmitter.setEnabled(std::any_of(tracks.begin(), tracks.end(),
+					      [](const auto &track) { return track->isConnected(); }));
+}
+
 void EnteiToolsDialog::onWebSocketConnected(bool connected)
 {
 	updateConnectionStatus(connected);
@@ -363,275 +861,261 @@ void EnteiToolsDialog::onWebSocketConnected(bool connected)
 	if (connected) {
 		logTextEdit->append("✓ Connected successfully");
 
-		// Send initial connection message
-		const char *connect_json = "{\"type\":\"start_transcription\"}";
-		websocket_client_send(client, connect_json);
-		logTextEdit->append("→ Transcription started");
-
 		// Start periodic ping timer
 		heartbeatTimer->start();
 
-		// Start caption timer if we're already streaming
-		if (obs_frontend_streaming_active() && captionTimer) {
-			streamingActive = true;
-			captionTimer->start();
-		}
-
 		// Auto-join the specified channel
 		// Channel is now implicitly joined via connection
 	} else {
 		logTextEdit->append("✗ Connection failed or disconnected");
-		channel_joined = false;
 
 		// Stop timers
 		heartbeatTimer->stop();
-		if (captionTimer) {
-			captionTimer->stop();
-		}
-		pendingCaptionText.clear();
-		segments.clear();
-		lastComposedCaption.clear();
 	}
 }
 
-void EnteiToolsDialog::onWebSocketMessage(const QString &message)
-{
-	// Don't log raw messages - too noisy.
-	// logTextEdit->append(QString("← %1").arg(message));
-
-	// Process the WebSocket message
-	processWebSocketMessage(message.toUtf8().constData());
-}
-
-void EnteiToolsDialog::sendPing()
+void EnteiToolsDialog::onTrackConnected(CaptionTrack *track, bool connected)
 {
-	// Add defensive check in case timer fires after disconnect
-	if (!isConnected || !client) {
+	// Ignore events queued by tracks that were replaced in the meantime
+	auto it = std::find_if(tracks.begin(), tracks.end(), [track](const auto &t) { return t.get() == track; });
+	if (it == tracks.end()) {
 		return;
 	}
 
-	const char *ping_json = "{\"type\":\"ping\"}";
-	websocket_client_send(client, ping_json);
-}
-
-void EnteiToolsDialog::onCaptionTimer()
-{
-	// Only send captions if we're streaming
-	obs_output_t *streaming_output = obs_frontend_get_streaming_output();
-	if (!streaming_output) {
-		return;
+	if (connected) {
+		// Send initial connection message
+		const char *connect_json = "{\"type\":\"start_transcription\"}";
+		track->send(connect_json);
+	} else {
+		track->reset();
 	}
 
-	// Check if output is active
-	if (!obs_output_active(streaming_output)) {
-		obs_output_release(streaming_output);
-		return;
+	if (track == primaryTrack()) {
+		// Audio follows start_transcription so the server knows the session first
+		audioUplink.setBackend(connected ? track->backend() : nullptr);
+		onWebSocketConnected(connected);
+		if (connected) {
+			logTextEdit->append("→ Transcription started");
+		}
+	} else {
+		logTextEdit->append(QString("[%1] %2")
+					    .arg(track->service())
+					    .arg(connected ? "✓ Connected, transcription started"
+							   : "✗ Connection failed or disconnected"));
+		updateCaptionEmitter();
 	}
+}
 
-	// Apply debouncing to prevent too frequent caption updates
-	// obs-localvocal uses 500ms, but we'll use 1000ms for smoother viewing
-	qint64 now = QDateTime::currentMSecsSinceEpoch();
-	if (now - lastCaptionSentTime < 1000) {
-		obs_output_release(streaming_output);
-		return;
-	}
+void EnteiToolsDialog::createTracks(const QString &primaryUrl)
+{
+	destroyTracks();
+
+	tracks.push_back(
+		std::make_unique<CaptionTrack>(1, primaryUrl, workerPool, metrics, tracer, flightRecorder));
+
+	// Additional feeds: "<service> <url>" per line
+	std::set<int> services = {1};
+	const QStringList lines = additionalTracksEdit->toPlainText().split('\n', Qt::SkipEmptyParts);
+	for (const QString &rawLine : lines) {
+		QString line = rawLine.trimmed();
+		if (line.isEmpty()) {
+			continue;
+		}
 
-	// Send caption with current text
-	// Don't clear - keep sending same text until new caption arrives
-	if (!pendingCaptionText.isEmpty()) {
-		lastCaptionSentTime = now;
-		// CEA-708 Caption Formatting for Twitch Compliance
-		// Break text into lines of max 32 characters each (max 3 lines = 96 chars total)
-		const int MAX_LINE_LENGTH = 32;
-		const int MAX_LINES = 3;
-		QString formattedCaption = pendingCaptionText;
-
-		// Simple word-wrap to avoid breaking words
-		QStringList words = formattedCaption.split(' ', Qt::SkipEmptyParts);
-		QStringList lines;
-		QString currentLine;
-
-		for (const QString &word : words) {
-			QString testLine = currentLine.isEmpty() ? word : currentLine + " " + word;
-			if (testLine.length() <= MAX_LINE_LENGTH) {
-				currentLine = testLine;
-			} else {
-				if (!currentLine.isEmpty()) {
-					lines.append(currentLine);
-					currentLine = word;
-				} else {
-					// Single word longer than line limit - truncate it
-					lines.append(word.left(MAX_LINE_LENGTH));
-					currentLine.clear();
-				}
-			}
+		QStringList parts = line.split(' ', Qt::SkipEmptyParts);
+		bool ok = false;
+		int service = parts.size() == 2 ? parts[0].toInt(&ok) : 0;
+		QString error;
+		if (!ok || service < 2 || service > 63) {
+			logTextEdit->append(
+				QString("Error: Invalid track \"%1\" (expected \"<service 2-63> <url>\")").arg(line));
+			continue;
 		}
-		if (!currentLine.isEmpty()) {
-			lines.append(currentLine);
+		if (services.count(service)) {
+			logTextEdit->append(QString("Error: Caption service %1 is already in use").arg(service));
+			continue;
 		}
-
-		// Limit to max 3 lines
-		if (lines.size() > MAX_LINES) {
-			lines = lines.mid(0, MAX_LINES);
+		if (!validate_transcription_url(parts[1], error)) {
+			logTextEdit->append(QString("Error: Track %1: %2").arg(service).arg(error));
+			continue;
 		}
 
-		QString finalCaption = lines.join("\n");
-		QByteArray captionBytes = finalCaption.toUtf8();
-
-		// Clamp duration between 2-7 seconds like obs-localvocal does
-		// Use 3.5 seconds as a good middle ground for caption duration
-		const double caption_duration = 3.5;
-		obs_output_output_caption_text2(streaming_output, captionBytes.constData(), caption_duration);
-
-		// Debug: Log actual caption sends with timestamp
-		static qint64 lastLogTime = 0;
-		qint64 now = QDateTime::currentMSecsSinceEpoch();
-		if (now - lastLogTime > 5000) { // Log every 5 seconds to avoid spam
-			obs_log(LOG_INFO, "[Entei] Sending caption at %lld: %s", now,
-				captionBytes.left(50).constData());
-			lastLogTime = now;
-		}
+		services.insert(service);
+		tracks.push_back(std::make_unique<CaptionTrack>(service, parts[1], workerPool, metrics, tracer,
+								flightRecorder));
+	}
+
+	bool multiple = tracks.size() > 1;
+	for (const auto &track : tracks) {
+		track->setMinInterval(minIntervalSpinBox->value());
+		track->setReadingRate(readingRateSpinBox->value());
+		track->setMode(selectedCaptionMode());
+		track->setConnectHandler([this](CaptionTrack *t, bool connected) {
+			QMetaObject::invokeMethod(
+				this, [this, t, connected]() { onTrackConnected(t, connected); }, Qt::QueuedConnection);
+		});
+		track->setChangeHandler([this](CaptionTrack *) {
+			// The next tick picks the caption up; this only feeds the pacing statistics
+			captionEmitter.noteChanged();
+		});
+		track->setLogHandler([this, multiple](CaptionTrack *t, const QString &line) {
+			QString text = multiple ? QString("[%1] %2").arg(t->service()).arg(line) : line;
+			QMetaObject::invokeMethod(this, [this, text]() { logTextEdit->append(text); }, Qt::QueuedConnection);
+		});
 	}
 
-	obs_output_release(streaming_output);
+	std::vector<CaptionTrack *> emitted;
+	for (const auto &track : tracks) {
+		emitted.push_back(track.get());
+	}
+	captionEmitter.setTracks(emitted);
 }
 
-void EnteiToolsDialog::processWebSocketMessage(const char *json)
+void EnteiToolsDialog::destroyTracks()
 {
-	cJSON *root = cJSON_Parse(json);
-	if (!root) {
-		logTextEdit->append("✗ Failed to parse WebSocket message");
-		return;
+	// The tick must stop using the tracks before each one joins its network
+	// thread and drains its worker queue
+	captionEmitter.setTracks({});
+	audioUplink.setBackend(nullptr);
+	// Its listener lives on the primary track's io_context
+	metricsServer.stop();
+	tracks.clear();
+	if (latencyLabel) {
+		latencyLabel->setVisible(false);
 	}
+}
 
-	cJSON *type = cJSON_GetObjectItem(root, "type");
-	if (!type || !cJSON_IsString(type)) {
-		logTextEdit->append("✗ WebSocket message missing 'type' field");
-		cJSON_Delete(root);
-		return;
+CaptionTrack *EnteiToolsDialog::primaryTrack() const
+{
+	return tracks.empty() ? nullptr : tracks.front().get();
+}
+
+void EnteiToolsDialog::updateLatencyStatus()
+{
+	QStringList parts;
+	QStringList throughput;
+	for (const auto &track : tracks) {
+		if (track->lastLatency() > 0) {
+			// Share of transcribed characters that reached viewers rather than being dropped
+			CaptionPipeline::PagingStats paging = track->pagingStats();
+			quint64 total = paging.deliveredChars + paging.droppedChars;
+			double delivered = total ? 100.0 * paging.deliveredChars / total : 100.0;
+			parts.append(QString("CS%1 %2 ms (avg %3 ms, %4% delivered)")
+					     .arg(track->service())
+					     .arg(track->lastLatency())
+					     .arg(track->averageLatency(), 0, 'f', 0)
+					     .arg(delivered, 0, 'f', 0));
+			throughput.append(QString("CS%1: %2 chars delivered, %3 dropped, %4 page(s) queued")
+						  .arg(track->service())
+						  .arg(paging.deliveredChars)
+						  .arg(paging.droppedChars)
+						  .arg(paging.backlogPages));
+		}
 	}
 
-	const char *message_type = cJSON_GetStringValue(type);
-
-	if (strcmp(message_type, "connected") == 0) {
-		logTextEdit->append("✓ WebSocket connected");
-		channel_joined = true;
-	} else if (strcmp(message_type, "transcription") == 0) {
-		// Handle transcription messages with WhisperLive segment support
-		cJSON *data = cJSON_GetObjectItem(root, "data");
-		if (data) {
-			cJSON *text_item = cJSON_GetObjectItem(data, "text");
-			if (cJSON_IsString(text_item)) {
-				const char *caption_text = cJSON_GetStringValue(text_item);
-				if (caption_text) {
-					QString text = QString::fromUtf8(caption_text);
-
-					// Extract segment metadata if available (WhisperLive protocol)
-					cJSON *segment_id_item = cJSON_GetObjectItem(data, "segment_id");
-					cJSON *is_revision_item = cJSON_GetObjectItem(data, "is_revision");
-					cJSON *is_final_item = cJSON_GetObjectItem(data, "is_final");
-
-					if (segment_id_item && cJSON_IsNumber(segment_id_item)) {
-						// WhisperLive segment-based caption
-						double segment_id = cJSON_GetNumberValue(segment_id_item);
-						bool is_revision = is_revision_item ? cJSON_IsTrue(is_revision_item)
-										    : false;
-						bool is_final = is_final_item ? cJSON_IsTrue(is_final_item) : true;
-						qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
-
-						// Check if this is an update to existing segment
-						bool isUpdate = segments.contains(segment_id);
-
-						// Store/update segment
-						segments[segment_id] = {text, segment_id, is_final, is_revision,
-									timestamp};
-
-						// Build combined caption from all segments
-						QString composedCaption = buildCaptionFromSegments();
-
-						// Only update caption if this is a final segment or if enough time has passed
-						// This prevents too frequent updates from partial segments
-						static qint64 lastCaptionUpdate = 0;
-						qint64 timeSinceUpdate = timestamp - lastCaptionUpdate;
-
-						// Update if: final segment, OR partial but 500ms passed (like obs-localvocal)
-						if (composedCaption != lastComposedCaption &&
-						    (is_final || timeSinceUpdate > 500)) {
-							pendingCaptionText = composedCaption;
-							lastComposedCaption = composedCaption;
-							lastCaptionUpdate = timestamp;
-
-							// Log the change
-							QString logText = composedCaption.length() > 50
-										  ? composedCaption.left(47) + "..."
-										  : composedCaption;
-							QString statusIcon = is_final ? "📝" : "✏️";
-							QString updateType = isUpdate ? " (revised)" : "";
-							logTextEdit->append(QString("%1 %2%3")
-										    .arg(statusIcon)
-										    .arg(logText)
-										    .arg(updateType));
-						}
-					} else {
-						// Legacy simple caption format
-						static QString lastCaption;
-						static int duplicateCount = 0;
-
-						if (text != lastCaption) {
-							if (duplicateCount > 0) {
-								logTextEdit->append(QString("  (received %1 times)")
-											    .arg(duplicateCount + 1));
-								duplicateCount = 0;
-							}
-							// Truncate long captions in log for readability
-							QString logText = text.length() > 50 ? text.left(47) + "..."
-											     : text;
-							logTextEdit->append(QString("📝 %1").arg(logText));
-							lastCaption = text;
-							pendingCaptionText = text;
-						} else {
-							duplicateCount++;
-						}
-					}
-				}
-			}
+	// Per-output send timings
+	QStringList outputs;
+	for (const OutputRegistry::OutputStats &stats : captionEmitter.outputStats()) {
+		double averageUs = stats.captionsSent ? stats.totalEmitNs / 1000.0 / stats.captionsSent : 0.0;
+		outputs.append(QString("%1: %2 sent, %3 queued (%4 s delay), last %5 µs, avg %6 µs")
+				       .arg(QString::fromStdString(stats.name))
+				       .arg(stats.captionsSent)
+				       .arg(stats.captionsQueued)
+				       .arg(stats.delaySec)
+				       .arg(stats.lastEmitNs / 1000.0, 0, 'f', 1)
+				       .arg(averageUs, 0, 'f', 1));
+	}
+
+	// Caption channel load: how far sends run ahead of what the video can carry
+	CaptionPacer::Stats pacing = captionEmitter.pacerStats();
+	outputs.append(QString("Caption channel (%1 fps): backlog %2 ms, peak %3 ms, %4 deferred, %5 merged")
+			       .arg(captionEmitter.frameRate(), 0, 'f', 2)
+			       .arg(pacing.backlogMs)
+			       .arg(pacing.peakBacklogMs)
+			       .arg(pacing.deferred)
+			       .arg(pacing.merged));
+
+	if (audioUplink.active()) {
+		AudioUplink::Stats audio = audioUplink.stats();
+		outputs.append(QString("Audio uplink: %1 source(s), %2 message(s), %3 KiB sent, %4 dropped, "
+				       "%5 µs/10 ms resampling")
+				       .arg(audio.streams)
+				       .arg(audio.messagesSent)
+				       .arg(audio.bytesSent / 1024)
+				       .arg(audio.messagesDropped)
+				       .arg(audio.convertNsPer10ms / 1000.0, 0, 'f', 1));
+		outputs.append(QString("Audio capture: %1 overrun(s), %2 µs/10 ms on the audio thread")
+				       .arg(audio.overruns)
+				       .arg(audio.tapNsPer10ms / 1000.0, 0, 'f', 1));
+		if (audio.pcmBytesSent > audio.bytesSent) {
+			outputs.append(QString("Audio encoding: %1% of the PCM size")
+					       .arg(100.0 * audio.bytesSent / audio.pcmBytesSent, 0, 'f', 1));
+		}
+		if (voiceGatingCheckBox && voiceGatingCheckBox->isChecked()) {
+			outputs.append(QString("Voice gating: %1 utterance(s), %2 frame(s) / %3 KiB held back, "
+					       "%4 µs/10 ms detection")
+					       .arg(audio.speechSegments)
+					       .arg(audio.framesSuppressed)
+					       .arg(audio.bytesSaved / 1024)
+					       .arg(audio.vadNsPer10ms / 1000.0, 0, 'f', 1));
 		}
-	} else if (strcmp(message_type, "error") == 0) {
-		cJSON *message = cJSON_GetObjectItem(root, "message");
-		const char *error_msg = cJSON_IsString(message) ? cJSON_GetStringValue(message) : "Unknown error";
-		logTextEdit->append(QString("✗ Server error: %1").arg(error_msg));
-	} else if (strcmp(message_type, "pong") == 0) {
-		// Don't log pongs - too noisy
 	}
 
-	cJSON_Delete(root);
+	// Pipeline totals across every track
+	PipelineMetrics::Snapshot snapshot = metrics.snapshot();
+	const PipelineMetrics::HistogramSnapshot &captionLatency =
+		snapshot.histograms[PipelineMetrics::CaptionLatency];
+	outputs.append(QString("Pipeline: %1 message(s) (%2 KiB in, %3 KiB out), %4 caption(s), "
+			       "p50 %5 ms, p99 %6 ms")
+			       .arg(snapshot.counters[PipelineMetrics::MessagesReceived])
+			       .arg(snapshot.counters[PipelineMetrics::BytesIn] / 1024)
+			       .arg(snapshot.counters[PipelineMetrics::BytesOut] / 1024)
+			       .arg(snapshot.counters[PipelineMetrics::CaptionsEmitted])
+			       .arg(captionLatency.percentile(0.5) / 1000)
+			       .arg(captionLatency.percentile(0.99) / 1000));
+	outputs.append(QString("Workers: %1 queued, parse p99 %2 µs, compose p99 %3 µs, %4 parse error(s), "
+			       "%5 disconnect(s)")
+			       .arg(snapshot.gauges[PipelineMetrics::QueueDepth])
+			       .arg(snapshot.histograms[PipelineMetrics::ParseTime].percentile(0.99))
+			       .arg(snapshot.histograms[PipelineMetrics::ComposeTime].percentile(0.99))
+			       .arg(snapshot.counters[PipelineMetrics::ParseErrors])
+			       .arg(snapshot.counters[PipelineMetrics::Disconnects]));
+
+	latencyLabel->setText(QString("Latency: %1").arg(parts.join(", ")));
+	latencyLabel->setToolTip((throughput + outputs).join("\n"));
+	latencyLabel->setVisible(!parts.isEmpty());
 }
 
-void EnteiToolsDialog::websocket_connect_callback(bool connected, void *user_data)
+void EnteiToolsDialog::sendPing()
 {
-	if (!user_data) {
-		obs_log(LOG_WARNING, "WebSocket connect callback received null user_data");
+	// Add defensive check in case timer fires after disconnect
+	if (!isConnected || tracks.empty()) {
 		return;
 	}
 
-	EnteiToolsDialog *dialog = static_cast<EnteiToolsDialog *>(user_data);
-	QMetaObject::invokeMethod(
-		dialog, [dialog, connected]() { dialog->onWebSocketConnected(connected); }, Qt::QueuedConnection);
+	const char *ping_json = "{\"type\":\"ping\"}";
+	for (const auto &track : tracks) {
+		if (track->isConnected()) {
+			track->send(ping_json);
+		}
+	}
 }
 
-void EnteiToolsDialog::websocket_message_callback(const char *message, size_t len, void *user_data)
+void EnteiToolsDialog::onOutputStarted()
 {
-	if (!user_data || !message) {
-		obs_log(LOG_WARNING, "WebSocket message callback received null parameters");
-		return;
+	// Whether a reconnect keeps the stream delay buffer is a profile setting
+	bool preserveDelay = false;
+	config_t *profile = obs_frontend_get_profile_config();
+	if (profile) {
+		preserveDelay = config_get_bool(profile, "Output", "DelayPreserve");
 	}
 
-	EnteiToolsDialog *dialog = static_cast<EnteiToolsDialog *>(user_data);
-
-	// Copy the message since it might not be valid after this function returns
-	QString msg = QString::fromUtf8(message, len);
+	captionEmitter.outputStarted(preserveDelay);
+}
 
-	QMetaObject::invokeMethod(dialog, [dialog, msg]() { dialog->onWebSocketMessage(msg); }, Qt::QueuedConnection);
+void EnteiToolsDialog::onOutputStopped()
+{
+	captionEmitter.outputStopped();
 }
 
 void EnteiToolsDialog::obs_frontend_event_callback(enum obs_frontend_event event, void *private_data)
@@ -641,6 +1125,37 @@ void EnteiToolsDialog::obs_frontend_event_callback(enum obs_frontend_event event
 		return;
 	}
 
+	// Captions follow every output, whether or not auto-connect is on
+	switch (event) {
+	case OBS_FRONTEND_EVENT_STREAMING_STARTED:
+	case OBS_FRONTEND_EVENT_RECORDING_STARTED:
+	case OBS_FRONTEND_EVENT_REPLAY_BUFFER_STARTED:
+		dialog->onOutputStarted();
+		break;
+	case OBS_FRONTEND_EVENT_STREAMING_STOPPED:
+	case OBS_FRONTEND_EVENT_RECORDING_STOPPED:
+	case OBS_FRONTEND_EVENT_REPLAY_BUFFER_STOPPED:
+		dialog->onOutputStopped();
+		break;
+	case OBS_FRONTEND_EVENT_EXIT:
+		// Video stops ticking during shutdown; release every output now
+		dialog->captionEmitter.stop();
+		dialog->captionEmitter.clear();
+		dialog->audioUplink.setSources({});
+		break;
+	case OBS_FRONTEND_EVENT_SCENE_COLLECTION_CLEANUP:
+		// The tapped sources are about to be destroyed
+		dialog->audioUplink.setSources({});
+		break;
+	case OBS_FRONTEND_EVENT_FINISHED_LOADING:
+	case OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED:
+		// Sources only exist once a scene collection has loaded
+		dialog->populateAudioSources(dialog->audioSourceComboBox->currentData().toString());
+		break;
+	default:
+		break;
+	}
+
 	// Only handle events if auto-connect is enabled
 	if (!dialog->autoConnectCheckBox->isChecked()) {
 		return;
@@ -649,18 +1164,12 @@ void EnteiToolsDialog::obs_frontend_event_callback(enum obs_frontend_event event
 	switch (event) {
 	case OBS_FRONTEND_EVENT_EXIT:
 		// Perform cleanup when OBS is exiting
-		if (dialog->isConnected && dialog->client) {
-			websocket_client_destroy(dialog->client);
-			dialog->client = nullptr;
+		if (dialog->isConnected) {
+			dialog->destroyTracks();
 			dialog->isConnected = false;
 		}
 		break;
 	case OBS_FRONTEND_EVENT_STREAMING_STARTED:
-		dialog->streamingActive = true;
-		// Start caption timer when streaming starts
-		if (dialog->captionTimer && dialog->isConnected) {
-			dialog->captionTimer->start();
-		}
 		if (!dialog->isConnected) {
 			QMetaObject::invokeMethod(
 				dialog,
@@ -672,11 +1181,6 @@ void EnteiToolsDialog::obs_frontend_event_callback(enum obs_frontend_event event
 		}
 		break;
 	case OBS_FRONTEND_EVENT_STREAMING_STOPPED:
-		dialog->streamingActive = false;
-		// Stop caption timer when streaming stops
-		if (dialog->captionTimer) {
-			dialog->captionTimer->stop();
-		}
 		if (dialog->isConnected) {
 			QMetaObject::invokeMethod(
 				dialog,
@@ -691,29 +1195,3 @@ void EnteiToolsDialog::obs_frontend_event_callback(enum obs_frontend_event event
 		break;
 	}
 }
-
-QString EnteiToolsDialog::buildCaptionFromSegments()
-{
-	// Remove old segments (older than 10 seconds)
-	qint64 now = QDateTime::currentMSecsSinceEpoch();
-	const qint64 SEGMENT_TIMEOUT = 10000; // 10 seconds
-
-	QMutableMapIterator<double, CaptionSegment> it(segments);
-	while (it.hasNext()) {
-		it.next();
-		if (now - it.value().timestamp > SEGMENT_TIMEOUT) {
-			it.remove();
-		}
-	}
-
-	// Build combined caption from remaining segments
-	QString combinedCaption;
-	for (auto it = segments.begin(); it != segments.end(); ++it) {
-		if (!combinedCaption.isEmpty()) {
-			combinedCaption += " ";
-		}
-		combinedCaption += it.value().text;
-	}
-
-	return combinedCaption;
-}
@@ -3,20 +3,32 @@
 #include <QtWidgets/QDialog>
 #include <QtCore/QTimer>
 #include <QtCore/QString>
-#include <QtCore/QMap>
 #include <obs-frontend-api.h>
 
+#include <memory>
+#include <vector>
+
+#include "audio-uplink.h"
+#include "caption-emitter.h"
+#include "caption-track.h"
+#include "flight-recorder.h"
+#include "metrics-server.h"
+#include "pipeline-metrics.h"
+#include "pipeline-tracer.h"
+#include "worker-pool.h"
+
 QT_BEGIN_NAMESPACE
 class QLineEdit;
 class QPushButton;
 class QLabel;
 class QTextEdit;
+class QPlainTextEdit;
 class QCheckBox;
+class QSpinBox;
+class QComboBox;
 class QCloseEvent;
 QT_END_NAMESPACE
 
-struct websocket_client;
-
 class EnteiToolsDialog : public QDialog {
 	Q_OBJECT
 
@@ -24,6 +36,10 @@ public:
 	EnteiToolsDialog(QWidget *parent = nullptr);
 	~EnteiToolsDialog();
 
+	// Lives as long as the dialog; safe to snapshot from any thread
+	PipelineMetrics &pipelineMetrics() { return metrics; }
+	PipelineTracer &pipelineTracer() { return tracer; }
+
 protected:
 	void closeEvent(QCloseEvent *event) override;
 	void showEvent(QShowEvent *event) override;
@@ -33,22 +49,41 @@ private slots:
 	void onDisconnectClicked();
 	void onWebSocketUrlChanged();
 	void onAutoConnectToggled(bool enabled);
-	void onCaptionTimer();
+	void onMinIntervalChanged(int interval);
+	void onReadingRateChanged(int wordsPerMinute);
+	void onCaptionModeChanged(int index);
+	void onCaptionEncoderChanged(int index);
+	void onAudioSourceChanged(int index);
+	void onAudioFramingChanged(int value);
+	void onVoiceGatingChanged();
+	void onAudioEncodingChanged(int index);
+	void onMetricsPortEdited();
 
 private:
 	void setupUI();
 	void loadSettings();
 	void saveSettings();
 	void updateConnectionStatus(bool connected);
+	void updateCaptionEmitter();
 	void onWebSocketConnected(bool connected);
-	void onWebSocketMessage(const QString &message);
+	void onTrackConnected(CaptionTrack *track, bool connected);
+	void updateLatencyStatus();
+	CaptionPipeline::Mode selectedCaptionMode() const;
+	bool useNativeEncoder() const;
+	void populateAudioSources(const QString &selected);
+	void applyAudioSources();
+	void startMetricsServer();
+	void onOutputStarted();
+	void onOutputStopped();
+
+	// Caption track helpers
+	void createTracks(const QString &primaryUrl);
+	void destroyTracks();
+	CaptionTrack *primaryTrack() const;
 
 	// WebSocket protocol helpers
 	void sendPing();
-	void processWebSocketMessage(const char *json);
 
-	static void websocket_connect_callback(bool connected, void *user_data);
-	static void websocket_message_callback(const char *message, size_t len, void *user_data);
 	static void obs_frontend_event_callback(enum obs_frontend_event event, void *private_data);
 
 	QLineEdit *websocketUrlEdit;
@@ -57,31 +92,44 @@ private:
 	QLabel *statusLabel;
 	QTextEdit *logTextEdit;
 	QCheckBox *autoConnectCheckBox;
+	QPlainTextEdit *additionalTracksEdit;
+	QLabel *latencyLabel;
+	QSpinBox *minIntervalSpinBox;
+	QSpinBox *readingRateSpinBox;
+	QComboBox *captionModeComboBox;
+	QComboBox *captionEncoderComboBox;
+	QComboBox *audioSourceComboBox;
+	QPlainTextEdit *additionalAudioSourcesEdit;
+	QSpinBox *audioFrameSpinBox;
+	QSpinBox *audioFramesPerMessageSpinBox;
+	QComboBox *audioEncodingComboBox;
+	QCheckBox *voiceGatingCheckBox;
+	QSpinBox *vadHangoverSpinBox;
+	QSpinBox *metricsPortSpinBox;
 
-	struct websocket_client *client;
 	bool isConnected;
 
-	// WebSocket state
-	bool channel_joined;
-
 	// Ping timer for WebSocket connection
 	QTimer *heartbeatTimer;
 
-	// Caption stream management
-	QTimer *captionTimer;
-	QString pendingCaptionText;
-	bool streamingActive;
-	qint64 lastCaptionSentTime; // Track when we last sent a caption to OBS
-
-	// WhisperLive segment tracking
-	struct CaptionSegment {
-		QString text;
-		double segment_id;
-		bool is_final;
-		bool is_revision;
-		qint64 timestamp;
-	};
-	QMap<double, CaptionSegment> segments;
-	QString lastComposedCaption;
-	QString buildCaptionFromSegments();
+	// Recorded into by every component below, so they are declared first and destroyed last
+	PipelineMetrics metrics;
+	PipelineTracer tracer;
+	// Dumps on the worker pool, which is declared after it so it is joined first
+	FlightRecorder flightRecorder;
+
+	// Sends captions to the active outputs from the video tick, off the UI thread
+	CaptionEmitter captionEmitter;
+
+	// Streams the selected audio sources to the primary track's server
+	AudioUplink audioUplink;
+
+	// Prometheus endpoint on the primary track's network thread; stopped before the tracks are destroyed
+	MetricsServer metricsServer;
+
+	// Shared by every track for parsing and composition
+	WorkerPool workerPool;
+
+	// One track per transcription feed; the first one is the primary URL on caption service 1
+	std::vector<std::unique_ptr<CaptionTrack>> tracks;
 };
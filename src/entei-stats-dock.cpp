@@ -0,0 +1,182 @@
+#include "entei-stats-dock.h"
+#include "entei-dialog.h"
+#include <obs-module.h>
+#include "plugin-support.h"
+
+#include <QtWidgets/QCheckBox>
+#include <QtWidgets/QFileDialog>
+#include <QtWidgets/QGridLayout>
+#include <QtWidgets/QLabel>
+#include <QtWidgets/QPushButton>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QTimer>
+#include <QtGui/QHideEvent>
+#include <QtGui/QShowEvent>
+
+static const int REFRESH_INTERVAL_MS = 1000;
+// Rates and percentiles cover this many refreshes
+static const size_t WINDOW_SNAPSHOTS = 10;
+// Captions this late are flagged
+static const uint64_t LAGGING_LATENCY_MS = 3000;
+
+EnteiStatsDock::EnteiStatsDock(EnteiToolsDialog *dialog, QWidget *parent)
+	: QWidget(parent),
+	  dialog(dialog),
+	  refreshTimer(nullptr)
+{
+	QGridLayout *layout = new QGridLayout(this);
+	layout->setContentsMargins(10, 10, 10, 10);
+	layout->setColumnStretch(1, 1);
+
+	messageRateLabel = addRow(layout, "Messages:");
+	captionRateLabel = addRow(layout, "Captions:");
+	latencyLabel = addRow(layout, "Caption latency:");
+	processingLabel = addRow(layout, "Processing:");
+	queueDepthLabel = addRow(layout, "Queue depth:");
+	trafficLabel = addRow(layout, "Traffic:");
+	dropsLabel = addRow(layout, "Dropped:");
+	connectionsLabel = addRow(layout, "Connections:");
+
+	// Tracing costs a few hundred KiB per thread while on, so it is off until needed
+	int traceRow = layout->rowCount();
+	traceCheckBox = new QCheckBox("Trace pipeline");
+	traceCheckBox->setToolTip("Record every caption's stages for Chrome tracing or Perfetto");
+	connect(traceCheckBox, &QCheckBox::toggled, this, &EnteiStatsDock::onTraceToggled);
+	layout->addWidget(traceCheckBox, traceRow, 0);
+	saveTraceButton = new QPushButton("Save Trace...");
+	saveTraceButton->setEnabled(false);
+	connect(saveTraceButton, &QPushButton::clicked, this, &EnteiStatsDock::onSaveTraceClicked);
+	layout->addWidget(saveTraceButton, traceRow, 1, Qt::AlignLeft);
+	layout->setRowStretch(layout->rowCount(), 1);
+
+	latencyLabel->setToolTip(QString("Receive-to-emit latency over the last %1 s").arg(WINDOW_SNAPSHOTS));
+	dropsLabel->setToolTip("Uplink audio the backend did not take, and messages that failed to parse");
+
+	refreshTimer = new QTimer(this);
+	refreshTimer->setInterval(REFRESH_INTERVAL_MS);
+	connect(refreshTimer, &QTimer::timeout, this, &EnteiStatsDock::refresh);
+}
+
+EnteiStatsDock::~EnteiStatsDock()
+{
+	refreshTimer->stop();
+}
+
+QLabel *EnteiStatsDock::addRow(QGridLayout *layout, const QString &name)
+{
+	int row = layout->rowCount();
+	layout->addWidget(new QLabel(name), row, 0);
+	QLabel *value = new QLabel("—");
+	value->setTextInteractionFlags(Qt::TextSelectableByMouse);
+	layout->addWidget(value, row, 1);
+	return value;
+}
+
+void EnteiStatsDock::showEvent(QShowEvent *event)
+{
+	QWidget::showEvent(event);
+	refresh();
+	refreshTimer->start();
+}
+
+void EnteiStatsDock::hideEvent(QHideEvent *event)
+{
+	// Nothing is sampled while hidden, so the window starts over when shown again
+	refreshTimer->stop();
+	history.clear();
+	QWidget::hideEvent(event);
+}
+
+void EnteiStatsDock::onTraceToggled(bool enabled)
+{
+	if (!dialog) {
+		return;
+	}
+	PipelineTracer &tracer = dialog->pipelineTracer();
+	if (enabled) {
+		tracer.clear();
+	}
+	tracer.setEnabled(enabled);
+	saveTraceButton->setEnabled(enabled);
+}
+
+void EnteiStatsDock::onSaveTraceClicked()
+{
+	if (!dialog) {
+		return;
+	}
+
+	QString path = QFileDialog::getSaveFileName(this, "Save Pipeline Trace",
+						    QDir::home().filePath("entei-trace.json"),
+						    "Chrome trace (*.json)");
+	if (path.isEmpty()) {
+		return;
+	}
+
+	std::string trace = dialog->pipelineTracer().chromeTrace();
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+	    file.write(trace.data(), (qint64)trace.size()) != (qint64)trace.size()) {
+		obs_log(LOG_WARNING, "[Entei] Failed to save pipeline trace to %s", path.toUtf8().constData());
+		return;
+	}
+	obs_log(LOG_INFO, "[Entei] Saved pipeline trace to %s", path.toUtf8().constData());
+}
+
+void EnteiStatsDock::refresh()
+{
+	if (!dialog) {
+		refreshTimer->stop();
+		return;
+	}
+
+	history.push_back(dialog->pipelineMetrics().snapshot());
+	while (history.size() > WINDOW_SNAPSHOTS + 1) {
+		history.pop_front();
+	}
+	const PipelineMetrics::Snapshot &latest = history.back();
+	const PipelineMetrics::Snapshot &oldest = history.front();
+	double seconds = (latest.takenAt - oldest.takenAt) / 1e9;
+	auto rate = [&](PipelineMetrics::Counter counter) {
+		return seconds > 0.0 ? (latest.counters[counter] - oldest.counters[counter]) / seconds : 0.0;
+	};
+
+	messageRateLabel->setText(QString("%1/s (%2 total)")
+					  .arg(rate(PipelineMetrics::MessagesReceived), 0, 'f', 1)
+					  .arg(latest.counters[PipelineMetrics::MessagesReceived]));
+	captionRateLabel->setText(QString("%1/s (%2 total)")
+					  .arg(rate(PipelineMetrics::CaptionsEmitted), 0, 'f', 1)
+					  .arg(latest.counters[PipelineMetrics::CaptionsEmitted]));
+	trafficLabel->setText(QString("%1 KiB/s in, %2 KiB/s out")
+				      .arg(rate(PipelineMetrics::BytesIn) / 1024.0, 0, 'f', 1)
+				      .arg(rate(PipelineMetrics::BytesOut) / 1024.0, 0, 'f', 1));
+
+	PipelineMetrics::HistogramSnapshot latency = latest.histograms[PipelineMetrics::CaptionLatency].since(
+		oldest.histograms[PipelineMetrics::CaptionLatency]);
+	if (latency.count > 0) {
+		uint64_t p99 = latency.percentile(0.99) / 1000;
+		latencyLabel->setText(QString("p50 %1 ms, p99 %2 ms").arg(latency.percentile(0.5) / 1000).arg(p99));
+		latencyLabel->setStyleSheet(p99 > LAGGING_LATENCY_MS ? "QLabel { font-weight: bold; color: red; }"
+								     : "");
+	} else {
+		latencyLabel->setText("—");
+		latencyLabel->setStyleSheet("");
+	}
+
+	PipelineMetrics::HistogramSnapshot parse =
+		latest.histograms[PipelineMetrics::ParseTime].since(oldest.histograms[PipelineMetrics::ParseTime]);
+	PipelineMetrics::HistogramSnapshot compose =
+		latest.histograms[PipelineMetrics::ComposeTime].since(oldest.histograms[PipelineMetrics::ComposeTime]);
+	processingLabel->setText(QString("parse p99 %1 µs, compose p99 %2 µs")
+					 .arg(parse.percentile(0.99))
+					 .arg(compose.percentile(0.99)));
+
+	queueDepthLabel->setText(QString::number(latest.gauges[PipelineMetrics::QueueDepth]));
+	dropsLabel->setText(QString("%1 audio payload(s), %2 parse error(s)")
+				    .arg(latest.counters[PipelineMetrics::AudioDropped])
+				    .arg(latest.counters[PipelineMetrics::ParseErrors]));
+	connectionsLabel->setText(QString("%1 connect(s), %2 disconnect(s)")
+					  .arg(latest.counters[PipelineMetrics::Connects])
+					  .arg(latest.counters[PipelineMetrics::Disconnects]));
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QtWidgets/QWidget>
+#include <QtCore/QPointer>
+
+#include <deque>
+
+#include "pipeline-metrics.h"
+
+QT_BEGIN_NAMESPACE
+class QCheckBox;
+class QGridLayout;
+class QLabel;
+class QPushButton;
+class QTimer;
+QT_END_NAMESPACE
+
+class EnteiToolsDialog;
+
+// OBS dock with live caption pipeline statistics, so operators see captions
+// lagging before viewers do.
+//
+// Once a second it takes a PipelineMetrics snapshot and shows message and
+// caption rates, p50/p99 caption latency, queue depth and drop counters.
+// Rates and percentiles cover the last ten seconds, from the difference
+// between the newest and the oldest snapshot kept. Snapshots only read
+// atomics, so the pipeline never waits on the dock.
+//
+// The dock also switches the PipelineTracer on and off and saves what it
+// recorded as a Chrome trace.
+class EnteiStatsDock : public QWidget {
+	Q_OBJECT
+
+public:
+	// The metrics belong to the dialog; the dock goes blank if the dialog is destroyed first
+	explicit EnteiStatsDock(EnteiToolsDialog *dialog, QWidget *parent = nullptr);
+	~EnteiStatsDock();
+
+protected:
+	void showEvent(QShowEvent *event) override;
+	void hideEvent(QHideEvent *event) override;
+
+private slots:
+	void refresh();
+	void onTraceToggled(bool enabled);
+	void onSaveTraceClicked();
+
+private:
+	static QLabel *addRow(QGridLayout *layout, const QString &name);
+
+	QPointer<EnteiToolsDialog> dialog;
+	QTimer *refreshTimer;
+	// Oldest first, spanning the rate window
+	std::deque<PipelineMetrics::Snapshot> history;
+
+	QLabel *messageRateLabel;
+	QLabel *captionRateLabel;
+	QLabel *trafficLabel;
+	QLabel *latencyLabel;
+	QLabel *processingLabel;
+	QLabel *queueDepthLabel;
+	QLabel *dropsLabel;
+	QLabel *connectionsLabel;
+	QCheckBox *traceCheckBox;
+	QPushButton *saveTraceButton;
+};
@@ -1,11 +1,15 @@
 #include "entei-tools.h"
 #include "entei-dialog.h"
+#include "entei-stats-dock.h"
 #include <obs-module.h>
 #include <obs-frontend-api.h>
 #include "plugin-support.h"
 #include <QtWidgets/QWidget>
 
 static EnteiToolsDialog *dialog = nullptr;
+static bool stats_dock_added = false;
+
+static const char *STATS_DOCK_ID = "entei-caption-stats";
 
 static void entei_tools_menu_clicked(void *private_data)
 {
@@ -29,6 +33,14 @@ void register_entei_tools_menu(void)
 
 	obs_frontend_add_tools_menu_item("Entei Caption Provider", entei_tools_menu_clicked, nullptr);
 	obs_log(LOG_INFO, "Entei Tools menu registered");
+
+	// Live pipeline statistics, listed under the Docks menu; OBS owns the widget once added
+	EnteiStatsDock *stats_dock = new EnteiStatsDock(dialog, main_window);
+	stats_dock_added = obs_frontend_add_dock_by_id(STATS_DOCK_ID, "Entei Caption Stats", stats_dock);
+	if (!stats_dock_added) {
+		obs_log(LOG_WARNING, "Entei stats dock could not be added");
+		delete stats_dock;
+	}
 }
 
 void unregister_entei_tools_menu(void)
@@ -41,5 +53,10 @@ void unregister_entei_tools_menu(void)
 		dialog = nullptr;
 	}
 
+	if (stats_dock_added) {
+		obs_frontend_remove_dock(STATS_DOCK_ID);
+		stats_dock_added = false;
+	}
+
 	obs_log(LOG_INFO, "Entei Tools menu unregistered");
 }
@@ -0,0 +1,150 @@
+#include "flight-recorder.h"
+#include "worker-pool.h"
+#include <obs-module.h>
+#include <util/platform.h>
+#include "plugin-support.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+FlightRecorder::FlightRecorder(WorkerPool &pool) : pool(pool), written(0), lastDumpAt(0) {}
+
+FlightRecorder::~FlightRecorder() {}
+
+const char *FlightRecorder::name(Event event)
+{
+	switch (event) {
+	case Frame:
+		return "frame";
+	case Parse:
+		return "parse";
+	case ParseError:
+		return "parse-error";
+	case Compose:
+		return "compose";
+	case Emit:
+		return "emit";
+	case Connected:
+		return "connected";
+	case Disconnected:
+		return "disconnected";
+	default:
+		return "unknown";
+	}
+}
+
+const char *FlightRecorder::name(Trigger trigger)
+{
+	switch (trigger) {
+	case ConnectionLost:
+		return "connection-lost";
+	case ParseFailure:
+		return "parse-failure";
+	case LatencyBreach:
+		return "latency-breach";
+	default:
+		return "unknown";
+	}
+}
+
+void FlightRecorder::record(Event event, int service, uint64_t message, int64_t value)
+{
+	uint64_t index = written.fetch_add(1, std::memory_order_relaxed);
+	Slot &slot = slots[index % RING_EVENTS];
+
+	// Readers skip the slot until its sequence names this event
+	slot.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.timestamp.store(os_gettime_ns(), std::memory_order_relaxed);
+	slot.message.store(message, std::memory_order_relaxed);
+	slot.value.store(value, std::memory_order_relaxed);
+	slot.kind.store((uint32_t)event << 16 | ((uint32_t)service & 0xffff), std::memory_order_relaxed);
+	slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+bool FlightRecorder::trigger(Trigger trigger, int service)
+{
+	uint64_t now = os_gettime_ns();
+	uint64_t last = lastDumpAt.load(std::memory_order_relaxed);
+	do {
+		if (last != 0 && now - last < DUMP_INTERVAL_NS) {
+			return false;
+		}
+	} while (!lastDumpAt.compare_exchange_weak(last, now, std::memory_order_relaxed));
+
+	// Copying and writing happen on the pool, so the triggering thread only pays for the post
+	return pool.post([this, trigger, service, now]() { dump(trigger, service, now); });
+}
+
+void FlightRecorder::dump(Trigger trigger, int service, uint64_t triggeredAt) const
+{
+	struct Copied {
+		uint64_t timestamp;
+		uint64_t message;
+		int64_t value;
+		uint32_t kind;
+	};
+
+	std::vector<Copied> events;
+	events.reserve(RING_EVENTS);
+	uint64_t end = written.load(std::memory_order_acquire);
+	uint64_t start = end > RING_EVENTS ? end - RING_EVENTS : 0;
+	for (uint64_t index = start; index < end; index++) {
+		const Slot &slot = slots[index % RING_EVENTS];
+		if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+			continue; // Still being written, or already overwritten
+		}
+		Copied event;
+		event.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+		event.message = slot.message.load(std::memory_order_relaxed);
+		event.value = slot.value.load(std::memory_order_relaxed);
+		event.kind = slot.kind.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != index + 1) {
+			continue; // Overwritten while it was read
+		}
+		events.push_back(event);
+	}
+
+	char *directory = obs_module_config_path("flight-recorder");
+	if (!directory) {
+		return;
+	}
+	std::string path = directory;
+	bfree(directory);
+	os_mkdirs(path.c_str());
+
+	time_t now = time(nullptr);
+	struct tm local;
+#ifdef _WIN32
+	localtime_s(&local, &now);
+#else
+	localtime_r(&now, &local);
+#endif
+	char stamp[32];
+	strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+	path += "/flight-" + std::string(stamp) + "-" + name(trigger) + ".log";
+
+	FILE *file = os_fopen(path.c_str(), "w");
+	if (!file) {
+		obs_log(LOG_WARNING, "[Entei] Failed to write flight recorder dump to %s", path.c_str());
+		return;
+	}
+
+	// Times are relative to the trigger, so the events leading up to it are negative
+	fprintf(file, "# Entei flight recorder: %s on service %d, %zu events\n", name(trigger), service,
+		events.size());
+	fprintf(file, "# time_ms service event message value\n");
+	for (const Copied &event : events) {
+		double offset = ((double)event.timestamp - (double)triggeredAt) / 1e6;
+		fprintf(file, "%.3f %d %s %" PRIu64 " %" PRId64 "\n", offset, (int)(event.kind & 0xffff),
+			name((Event)(event.kind >> 16)), event.message, event.value);
+	}
+	fclose(file);
+
+	obs_log(LOG_WARNING, "[Entei] Flight recorder: %s on service %d, dumped %zu events to %s", name(trigger),
+		service, events.size(), path.c_str());
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class WorkerPool;
+
+// Always-on record of the most recent pipeline events, written to a file in
+// the plugin's config directory when something goes wrong: a connection
+// lost without being asked to close, a message that fails to parse, or a
+// caption later than LATENCY_SLO_MS.
+//
+// Every thread records into one fixed ring of RING_EVENTS slots, claimed
+// with a single relaxed fetch_add and filled without a lock; a per-slot
+// sequence number lets a dump skip any slot that is being rewritten while
+// it is copied. Nothing is allocated or formatted until a dump is
+// triggered, and dumps are copied and written on the WorkerPool, at most
+// one per DUMP_INTERVAL_NS, so a burst of failures writes a single file.
+class FlightRecorder {
+public:
+	enum Event : uint8_t {
+		Frame,        // Message or segment handed over by the backend (value: bytes)
+		Parse,        // Message parsed (value: µs)
+		ParseError,   // Message that could not be parsed or had no type (value: µs)
+		Compose,      // Message ingested into the caption pipeline (value: µs)
+		Emit,         // New caption taken for sending (value: latency in ms)
+		Connected,    // Backend connection established
+		Disconnected, // Backend connection lost (value: 1 if it was asked to close)
+		EVENT_COUNT
+	};
+
+	enum Trigger {
+		ConnectionLost,
+		ParseFailure,
+		LatencyBreach,
+	};
+
+	// Events kept across all threads
+	static constexpr size_t RING_EVENTS = 4096;
+	// Captions later than this trigger a dump
+	static constexpr int64_t LATENCY_SLO_MS = 3000;
+	// Triggers within this long of the last dump are ignored
+	static constexpr uint64_t DUMP_INTERVAL_NS = 30000000000ULL;
+
+	// Dumps are written on the pool, which must be destroyed first so none outlives the recorder
+	explicit FlightRecorder(WorkerPool &pool);
+	~FlightRecorder();
+
+	FlightRecorder(const FlightRecorder &) = delete;
+	FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+	// Hot path: any thread, never blocks or allocates
+	void record(Event event, int service, uint64_t message = 0, int64_t value = 0);
+	// Queues a dump unless one was written recently; false if skipped
+	bool trigger(Trigger trigger, int service);
+
+	static const char *name(Event event);
+	static const char *name(Trigger trigger);
+
+private:
+	struct Slot {
+		// Index + 1 once the slot holds event index, 0 while it is being written
+		std::atomic<uint64_t> sequence{0};
+		std::atomic<uint64_t> timestamp{0};
+		std::atomic<uint64_t> message{0};
+		std::atomic<int64_t> value{0};
+		std::atomic<uint32_t> kind{0}; // event << 16 | service
+	};
+
+	void dump(Trigger trigger, int service, uint64_t triggeredAt) const;
+
+	WorkerPool &pool;
+	std::atomic<uint64_t> written;
+	std::atomic<uint64_t> lastDumpAt;
+	Slot slots[RING_EVENTS];
+};
@@ -0,0 +1,276 @@
+#include "metrics-server.h"
+#include <obs-module.h>
+#include "plugin-support.h"
+
+#include <asio.hpp>
+
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+
+// A Prometheus scrape request is a few hundred bytes
+static const size_t MAX_REQUEST_BYTES = 4096;
+// Connections that have not sent a whole request by then are dropped
+static const std::chrono::milliseconds REQUEST_TIMEOUT(5000);
+
+struct HistogramExport {
+	PipelineMetrics::Histogram histogram;
+	const char *name;
+	const char *help;
+	std::array<double, 9> bounds; // Seconds, ascending; zeros at the end are unused
+};
+
+static const HistogramExport HISTOGRAMS[] = {
+	{PipelineMetrics::CaptionLatency,
+	 "entei_caption_latency_seconds",
+	 "Time from receiving a transcript to emitting its caption.",
+	 {0.1, 0.25, 0.5, 1.0, 1.5, 2.0, 3.0, 5.0, 10.0}},
+	{PipelineMetrics::ParseTime,
+	 "entei_parse_seconds",
+	 "Time to parse one transcription message.",
+	 {0.00001, 0.00005, 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1}},
+	{PipelineMetrics::ComposeTime,
+	 "entei_compose_seconds",
+	 "Time to ingest one message into the caption pipeline.",
+	 {0.00001, 0.00005, 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1}},
+};
+
+static const char *counter_help(PipelineMetrics::Counter counter)
+{
+	switch (counter) {
+	case PipelineMetrics::MessagesReceived:
+		return "Messages and segments handed over by the transcription backends.";
+	case PipelineMetrics::ParseErrors:
+		return "Messages that could not be parsed.";
+	case PipelineMetrics::CaptionsEmitted:
+		return "New captions sent to the outputs.";
+	case PipelineMetrics::BytesIn:
+		return "Bytes of transcription messages received.";
+	case PipelineMetrics::BytesOut:
+		return "Bytes of control messages and uplink audio sent.";
+	case PipelineMetrics::AudioDropped:
+		return "Uplink audio payloads the backend did not take.";
+	case PipelineMetrics::Connects:
+		return "Transcription connections established.";
+	case PipelineMetrics::Disconnects:
+		return "Transcription connections lost or closed.";
+	default:
+		return "";
+	}
+}
+
+// One scrape: read the request, answer it, close
+struct MetricsSession : std::enable_shared_from_this<MetricsSession> {
+	MetricsSession(asio::io_context &io, PipelineMetrics &metrics) : socket(io), timer(io), metrics(metrics) {}
+
+	void start()
+	{
+		auto self = shared_from_this();
+		timer.expires_after(REQUEST_TIMEOUT);
+		timer.async_wait([self](const std::error_code &ec) {
+			if (!ec) {
+				std::error_code ignored;
+				self->socket.close(ignored);
+			}
+		});
+		read();
+	}
+
+	void read()
+	{
+		auto self = shared_from_this();
+		socket.async_read_some(asio::buffer(buffer), [self](const std::error_code &ec, size_t size) {
+			if (ec) {
+				self->timer.cancel();
+				return;
+			}
+			self->request.append(self->buffer.data(), size);
+			if (self->request.find("\r\n\r\n") != std::string::npos ||
+			    self->request.size() >= MAX_REQUEST_BYTES) {
+				self->respond();
+			} else {
+				self->read();
+			}
+		});
+	}
+
+	void respond()
+	{
+		const char *status = "200 OK";
+		std::string body;
+		if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0) {
+			body = MetricsServer::exposition(metrics.snapshot());
+		} else if (request.compare(0, 4, "GET ") == 0) {
+			status = "404 Not Found";
+			body = "Not found; metrics are at /metrics\n";
+		} else {
+			status = "405 Method Not Allowed";
+			body = "Only GET is supported\n";
+		}
+
+		char header[256];
+		snprintf(header, sizeof(header),
+			 "HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+			 "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+			 status, body.size());
+		response = header + body;
+
+		auto self = shared_from_this();
+		asio::async_write(socket, asio::buffer(response), [self](const std::error_code &, size_t) {
+			std::error_code ignored;
+			self->socket.shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+			self->socket.close(ignored);
+			self->timer.cancel();
+		});
+	}
+
+	asio::ip::tcp::socket socket;
+	asio::steady_timer timer;
+	PipelineMetrics &metrics;
+	std::array<char, 1024> buffer;
+	std::string request;
+	std::string response;
+};
+
+struct MetricsServer::Listener : std::enable_shared_from_this<MetricsServer::Listener> {
+	Listener(asio::io_context &io, uint16_t port, PipelineMetrics &metrics)
+		: io(io),
+		  port(port),
+		  acceptor(io),
+		  metrics(metrics)
+	{
+	}
+
+	void accept()
+	{
+		auto self = shared_from_this();
+		auto session = std::make_shared<MetricsSession>(io, metrics);
+		acceptor.async_accept(session->socket, [self, session](const std::error_code &ec) {
+			if (ec == asio::error::operation_aborted || !self->acceptor.is_open()) {
+				return;
+			}
+			if (!ec) {
+				session->start();
+			}
+			self->accept();
+		});
+	}
+
+	asio::io_context &io;
+	uint16_t port;
+	asio::ip::tcp::acceptor acceptor;
+	PipelineMetrics &metrics;
+};
+
+MetricsServer::MetricsServer(PipelineMetrics &metrics) : metrics(metrics) {}
+
+MetricsServer::~MetricsServer()
+{
+	stop();
+}
+
+bool MetricsServer::start(asio::io_context &io, uint16_t port, std::string &error)
+{
+	// The old acceptor only closes once the network thread gets to it, so rebinding its port could fail
+	if (listener && &listener->io == &io && listener->port == port) {
+		return true;
+	}
+	stop();
+
+	// Opening and binding happen before any handler is queued, so this thread may still touch the acceptor
+	auto next = std::make_shared<Listener>(io, port, metrics);
+	asio::ip::tcp::endpoint endpoint(asio::ip::address_v4::loopback(), port);
+	std::error_code ec;
+	next->acceptor.open(endpoint.protocol(), ec);
+#ifndef _WIN32
+	// A listener closed on an earlier connection may leave the port in TIME_WAIT
+	if (!ec) {
+		next->acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true), ec);
+	}
+#endif
+	if (!ec) {
+		next->acceptor.bind(endpoint, ec);
+	}
+	if (!ec) {
+		next->acceptor.listen(asio::socket_base::max_listen_connections, ec);
+	}
+	if (ec) {
+		error = ec.message();
+		return false;
+	}
+
+	asio::post(io, [next]() { next->accept(); });
+	listener = next;
+	obs_log(LOG_INFO, "[Entei] Serving metrics at http://127.0.0.1:%u/metrics", (unsigned)port);
+	return true;
+}
+
+void MetricsServer::stop()
+{
+	if (!listener) {
+		return;
+	}
+
+	// The acceptor belongs to the network thread now; its last reference goes with the queued handlers
+	std::shared_ptr<Listener> closing = std::move(listener);
+	asio::post(closing->io, [closing]() {
+		std::error_code ignored;
+		closing->acceptor.close(ignored);
+	});
+}
+
+uint16_t MetricsServer::port() const
+{
+	return listener ? listener->port : 0;
+}
+
+std::string MetricsServer::exposition(const PipelineMetrics::Snapshot &snapshot)
+{
+	std::string text;
+	char line[512];
+
+	for (size_t i = 0; i < PipelineMetrics::COUNTER_COUNT; i++) {
+		PipelineMetrics::Counter counter = (PipelineMetrics::Counter)i;
+		const char *name = PipelineMetrics::name(counter);
+		snprintf(line, sizeof(line),
+			 "# HELP entei_%s_total %s\n# TYPE entei_%s_total counter\nentei_%s_total %" PRIu64 "\n", name,
+			 counter_help(counter), name, name, snapshot.counters[i]);
+		text += line;
+	}
+
+	snprintf(line, sizeof(line),
+		 "# HELP entei_queue_depth Messages waiting for a worker.\n# TYPE entei_queue_depth gauge\n"
+		 "entei_queue_depth %" PRId64 "\n",
+		 snapshot.gauges[PipelineMetrics::QueueDepth]);
+	text += line;
+
+	for (const HistogramExport &exported : HISTOGRAMS) {
+		const PipelineMetrics::HistogramSnapshot &histogram = snapshot.histograms[exported.histogram];
+		snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s histogram\n", exported.name, exported.help,
+			 exported.name);
+		text += line;
+
+		// Recordings are in µs buckets; each counts towards the bounds at or above its bucket's top
+		uint64_t cumulative = 0;
+		size_t bucket = 0;
+		for (double bound : exported.bounds) {
+			if (bound <= 0.0) {
+				break;
+			}
+			uint64_t limit = (uint64_t)(bound * 1e6 + 0.5);
+			while (bucket < histogram.buckets.size() &&
+			       PipelineMetrics::bucketUpperBound(bucket) <= limit) {
+				cumulative += histogram.buckets[bucket++];
+			}
+			snprintf(line, sizeof(line), "%s_bucket{le=\"%g\"} %" PRIu64 "\n", exported.name, bound,
+				 cumulative);
+			text += line;
+		}
+		snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %" PRIu64 "\n%s_sum %.6f\n%s_count %" PRIu64 "\n",
+			 exported.name, histogram.count, exported.name, histogram.sum / 1e6, exported.name,
+			 histogram.count);
+		text += line;
+	}
+	return text;
+}
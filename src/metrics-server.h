@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "pipeline-metrics.h"
+
+namespace asio {
+class io_context;
+}
+
+// Serves PipelineMetrics to Prometheus in its text exposition format at
+// http://127.0.0.1:<port>/metrics.
+//
+// The listener runs on an existing asio io_context, the primary track's
+// WebSocket network thread, rather than a thread of its own. It only binds
+// the loopback interface, answers one GET per connection and closes it, and
+// each scrape costs one PipelineMetrics snapshot on that thread.
+class MetricsServer {
+public:
+	explicit MetricsServer(PipelineMetrics &metrics);
+	// Must be stopped before the io_context it runs on is destroyed
+	~MetricsServer();
+
+	MetricsServer(const MetricsServer &) = delete;
+	MetricsServer &operator=(const MetricsServer &) = delete;
+
+	// Replaces any earlier listener unless it already serves this port on io; false if the port cannot be bound
+	bool start(asio::io_context &io, uint16_t port, std::string &error);
+	// The listener closes on its io_context's thread, or when that io_context is destroyed
+	void stop();
+	bool running() const { return listener != nullptr; }
+	// Port being served, 0 if stopped
+	uint16_t port() const;
+
+	// The whole exposition for one snapshot
+	static std::string exposition(const PipelineMetrics::Snapshot &snapshot);
+
+private:
+	struct Listener;
+
+	PipelineMetrics &metrics;
+	std::shared_ptr<Listener> listener;
+};
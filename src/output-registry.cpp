@@ -0,0 +1,320 @@
+#include "output-registry.h"
+#include <obs-module.h>
+#include <util/platform.h>
+#include "plugin-support.h"
+
+#include <algorithm>
+
+// Outputs from other plugins start without a frontend event, so re-check now and then
+static const uint64_t REFRESH_INTERVAL_NS = 2000000000ULL;
+
+OutputRegistry::OutputRegistry() : lastRefresh(0), dirty(true), preserveDelay(false) {}
+
+OutputRegistry::~OutputRegistry()
+{
+	clear();
+}
+
+void OutputRegistry::markDirty()
+{
+	dirty = true;
+}
+
+void OutputRegistry::setPreserveDelay(bool preserve)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	preserveDelay = preserve;
+}
+
+void OutputRegistry::clear()
+{
+	for (Entry &entry : outputs) {
+		disconnectSignals(entry.output);
+		obs_output_release(entry.output);
+	}
+	outputs.clear();
+	dirty = true;
+
+	std::vector<Pending> dropped;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		dropped.swap(queue);
+		reconnecting.clear();
+	}
+	for (Pending &pending : dropped) {
+		obs_output_release(pending.output);
+	}
+}
+
+OutputRegistry::Entry *OutputRegistry::find(const obs_output_t *output)
+{
+	auto it = std::find_if(outputs.begin(), outputs.end(),
+			       [output](const Entry &entry) { return entry.output == output; });
+	return it != outputs.end() ? &*it : nullptr;
+}
+
+bool OutputRegistry::enum_outputs_callback(void *param, obs_output_t *output)
+{
+	std::vector<Entry> *found = static_cast<std::vector<Entry> *>(param);
+
+	// Captions ride on encoded video packets
+	uint32_t flags = obs_output_get_flags(output);
+	if ((flags & OBS_OUTPUT_VIDEO) == 0 || (flags & OBS_OUTPUT_ENCODED) == 0) {
+		return true;
+	}
+	if (!obs_output_active(output)) {
+		return true;
+	}
+
+	obs_output_t *ref = obs_output_get_ref(output);
+	if (ref) {
+		Entry entry;
+		entry.output = ref;
+		entry.delayNs = 0;
+		const char *name = obs_output_get_name(ref);
+		entry.stats.name = name ? name : "";
+		found->push_back(entry);
+	}
+	return true;
+}
+
+bool OutputRegistry::refresh()
+{
+	uint64_t now = os_gettime_ns();
+	if (!dirty && now - lastRefresh < REFRESH_INTERVAL_NS) {
+		return !outputs.empty();
+	}
+
+	std::vector<Entry> found;
+	obs_enum_outputs(enum_outputs_callback, &found);
+
+	for (Entry &entry : found) {
+		// The active delay only changes when the output (re)starts, so reading it here
+		// keeps up with delay changes without touching the send path
+		entry.stats.delaySec = obs_output_get_active_delay(entry.output);
+		entry.delayNs = (uint64_t)entry.stats.delaySec * 1000000000ULL;
+
+		// Carry statistics over for outputs that are still running
+		if (Entry *previous = find(entry.output)) {
+			uint32_t delaySec = entry.stats.delaySec;
+			entry.stats = previous->stats;
+			entry.stats.delaySec = delaySec;
+		} else {
+			connectSignals(entry.output);
+		}
+	}
+
+	for (Entry &entry : outputs) {
+		auto it = std::find_if(found.begin(), found.end(),
+				       [&entry](const Entry &other) { return other.output == entry.output; });
+		if (it == found.end()) {
+			disconnectSignals(entry.output);
+		}
+		obs_output_release(entry.output);
+	}
+
+	if (found.size() != outputs.size()) {
+		obs_log(LOG_INFO, "[Entei] Sending captions to %zu output(s)", found.size());
+	}
+	outputs.swap(found);
+
+	lastRefresh = now;
+	dirty = false;
+	return !outputs.empty();
+}
+
+void OutputRegistry::connectSignals(obs_output_t *output)
+{
+	signal_handler_t *handler = obs_output_get_signal_handler(output);
+	signal_handler_connect(handler, "reconnect", output_reconnect_callback, this);
+	signal_handler_connect(handler, "reconnect_success", output_reconnect_success_callback, this);
+}
+
+void OutputRegistry::disconnectSignals(obs_output_t *output)
+{
+	signal_handler_t *handler = obs_output_get_signal_handler(output);
+	signal_handler_disconnect(handler, "reconnect", output_reconnect_callback, this);
+	signal_handler_disconnect(handler, "reconnect_success", output_reconnect_success_callback, this);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	reconnecting.erase(output);
+}
+
+void OutputRegistry::deliver(Entry *entry, obs_output_t *output, const Payload &payload)
+{
+	if (!obs_output_active(output)) {
+		dirty = true;
+		return;
+	}
+
+	uint64_t start = os_gettime_ns();
+	if (payload.data.empty()) {
+		obs_output_output_caption_text2(output, payload.text.c_str(), payload.duration);
+	} else {
+		struct obs_source_cea_708 captions = {};
+		captions.data = payload.data.data();
+		captions.packets = (uint32_t)(payload.data.size() / 3);
+		captions.timestamp = start;
+		obs_output_caption(output, &captions);
+	}
+
+	if (entry) {
+		entry->stats.lastEmitNs = os_gettime_ns() - start;
+		entry->stats.totalEmitNs += entry->stats.lastEmitNs;
+		entry->stats.captionsSent++;
+	}
+}
+
+size_t OutputRegistry::send(const std::shared_ptr<const Payload> &payload)
+{
+	uint64_t now = os_gettime_ns();
+	size_t sent = 0;
+
+	for (Entry &entry : outputs) {
+		if (!obs_output_active(entry.output)) {
+			dirty = true;
+			continue;
+		}
+
+		if (entry.delayNs == 0) {
+			deliver(&entry, entry.output, *payload);
+		} else {
+			obs_output_t *ref = obs_output_get_ref(entry.output);
+			if (!ref) {
+				continue;
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back({now + entry.delayNs, ref, payload});
+			std::push_heap(queue.begin(), queue.end(), std::greater<Pending>());
+		}
+		sent++;
+	}
+	return sent;
+}
+
+size_t OutputRegistry::sendText(const char *text, double duration)
+{
+	auto payload = std::make_shared<Payload>();
+	payload->text = text;
+	payload->duration = duration;
+	return send(payload);
+}
+
+size_t OutputRegistry::sendCaption(const uint8_t *data, size_t size)
+{
+	auto payload = std::make_shared<Payload>();
+	payload->data.assign(data, data + size);
+	return send(payload);
+}
+
+size_t OutputRegistry::releaseDue()
+{
+	uint64_t now = os_gettime_ns();
+	std::vector<Pending> due;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::vector<Pending> held;
+		while (!queue.empty() && queue.front().releaseAt <= now) {
+			std::pop_heap(queue.begin(), queue.end(), std::greater<Pending>());
+			Pending pending = std::move(queue.back());
+			queue.pop_back();
+
+			// A reconnecting output's video is stalled too; it waits for the outcome
+			if (reconnecting.count(pending.output)) {
+				held.push_back(std::move(pending));
+			} else {
+				due.push_back(std::move(pending));
+			}
+		}
+		for (Pending &pending : held) {
+			queue.push_back(std::move(pending));
+			std::push_heap(queue.begin(), queue.end(), std::greater<Pending>());
+		}
+	}
+
+	for (Pending &pending : due) {
+		deliver(find(pending.output), pending.output, *pending.payload);
+		obs_output_release(pending.output);
+	}
+	return due.size();
+}
+
+void OutputRegistry::onReconnect(obs_output_t *output)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	reconnecting.emplace(output, os_gettime_ns());
+}
+
+void OutputRegistry::onReconnectSuccess(obs_output_t *output)
+{
+	std::vector<Pending> dropped;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = reconnecting.find(output);
+		if (it == reconnecting.end()) {
+			return;
+		}
+		uint64_t outage = os_gettime_ns() - it->second;
+		reconnecting.erase(it);
+
+		if (preserveDelay) {
+			// The delay buffer was kept and grew by the outage
+			for (Pending &pending : queue) {
+				if (pending.output == output) {
+					pending.releaseAt += outage;
+				}
+			}
+		} else {
+			// The delay buffer was flushed along with the video these captions belonged to
+			auto keep = [output](const Pending &pending) { return pending.output != output; };
+			auto split = std::partition(queue.begin(), queue.end(), keep);
+			dropped.assign(std::make_move_iterator(split), std::make_move_iterator(queue.end()));
+			queue.erase(split, queue.end());
+		}
+		std::make_heap(queue.begin(), queue.end(), std::greater<Pending>());
+	}
+
+	if (!dropped.empty()) {
+		obs_log(LOG_INFO, "[Entei] Dropped %zu delayed caption(s) after reconnect", dropped.size());
+	}
+	for (Pending &pending : dropped) {
+		obs_output_release(pending.output);
+	}
+}
+
+void OutputRegistry::output_reconnect_callback(void *data, calldata_t *cd)
+{
+	OutputRegistry *registry = static_cast<OutputRegistry *>(data);
+	obs_output_t *output = static_cast<obs_output_t *>(calldata_ptr(cd, "output"));
+	if (registry && output) {
+		registry->onReconnect(output);
+	}
+}
+
+void OutputRegistry::output_reconnect_success_callback(void *data, calldata_t *cd)
+{
+	OutputRegistry *registry = static_cast<OutputRegistry *>(data);
+	obs_output_t *output = static_cast<obs_output_t *>(calldata_ptr(cd, "output"));
+	if (registry && output) {
+		registry->onReconnectSuccess(output);
+	}
+}
+
+std::vector<OutputRegistry::OutputStats> OutputRegistry::stats() const
+{
+	std::vector<OutputStats> result;
+	result.reserve(outputs.size());
+	for (const Entry &entry : outputs) {
+		result.push_back(entry.stats);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const Pending &pending : queue) {
+		for (size_t i = 0; i < outputs.size(); i++) {
+			if (outputs[i].output == pending.output) {
+				result[i].captionsQueued++;
+			}
+		}
+	}
+	return result;
+}
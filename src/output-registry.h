@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct obs_output;
+struct calldata;
+
+// Every active output that can carry captions: the stream, recordings, the
+// replay buffer and outputs added by other plugins.
+//
+// The list is cached and only re-enumerated when marked dirty or after it
+// goes stale, so each caption costs one send call per output.
+//
+// Outputs with a stream delay get their captions through a time-ordered
+// queue instead, released once the delayed video catches up with them.
+class OutputRegistry {
+public:
+	// One composed caption, shared read-only by every output it goes to
+	struct Payload {
+		std::string text;          // For obs_output_output_caption_text2
+		double duration = 0.0;     // Display duration for text captions
+		std::vector<uint8_t> data; // cc_data triplets for obs_output_caption, if not text
+	};
+
+	struct OutputStats {
+		std::string name;
+		uint32_t delaySec = 0;
+		uint64_t captionsSent = 0;
+		uint64_t captionsQueued = 0; // Waiting out the stream delay
+		uint64_t lastEmitNs = 0;     // Duration of the most recent send call
+		uint64_t totalEmitNs = 0;    // Summed send durations, for averaging
+	};
+
+	OutputRegistry();
+	~OutputRegistry();
+
+	OutputRegistry(const OutputRegistry &) = delete;
+	OutputRegistry &operator=(const OutputRegistry &) = delete;
+
+	// Forces a re-enumeration on the next refresh, e.g. after an output starts or stops
+	void markDirty();
+	// Re-enumerates if dirty or stale; returns true if any output is active
+	bool refresh();
+	void clear();
+
+	bool empty() const { return outputs.empty(); }
+	size_t size() const { return outputs.size(); }
+
+	// With preserve, a reconnect keeps the delay buffer and pushes it back by
+	// the outage; without it, captions queued for the old buffer are dropped
+	void setPreserveDelay(bool preserve);
+
+	// Sends to undelayed outputs now and queues for delayed ones; returns the
+	// number of outputs reached or queued
+	size_t send(const std::shared_ptr<const Payload> &payload);
+	size_t sendText(const char *text, double duration);
+	size_t sendCaption(const uint8_t *data, size_t size);
+
+	// Sends queued captions whose delay has elapsed
+	size_t releaseDue();
+
+	std::vector<OutputStats> stats() const;
+
+private:
+	struct Entry {
+		struct obs_output *output;
+		uint64_t delayNs;
+		OutputStats stats;
+	};
+
+	struct Pending {
+		uint64_t releaseAt;
+		struct obs_output *output; // Holds a reference until delivered or dropped
+		std::shared_ptr<const Payload> payload;
+
+		bool operator>(const Pending &other) const { return releaseAt > other.releaseAt; }
+	};
+
+	static bool enum_outputs_callback(void *param, struct obs_output *output);
+	static void output_reconnect_callback(void *data, struct calldata *cd);
+	static void output_reconnect_success_callback(void *data, struct calldata *cd);
+
+	Entry *find(const struct obs_output *output);
+	void connectSignals(struct obs_output *output);
+	void disconnectSignals(struct obs_output *output);
+	void deliver(Entry *entry, struct obs_output *output, const Payload &payload);
+	void onReconnect(struct obs_output *output);
+	void onReconnectSuccess(struct obs_output *output);
+
+	std::vector<Entry> outputs;
+	uint64_t lastRefresh;
+	bool dirty;
+
+	// Shared with output signal threads
+	mutable std::mutex mutex;
+	std::vector<Pending> queue; // Min-heap on releaseAt
+	std::map<const struct obs_output *, uint64_t> reconnecting;
+	bool preserveDelay;
+};
@@ -0,0 +1,188 @@
+#include "pipeline-metrics.h"
+#include <util/platform.h>
+
+#include <algorithm>
+#include <cmath>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Threads are dealt shards in turn as they first record
+static std::atomic<size_t> next_shard{0};
+
+static unsigned highest_bit(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return (unsigned)index;
+#else
+	return 63u - (unsigned)__builtin_clzll(value);
+#endif
+}
+
+PipelineMetrics::PipelineMetrics() : shards(new Shard[SHARD_COUNT])
+{
+	for (size_t i = 0; i < SHARD_COUNT; i++) {
+		Shard &s = shards[i];
+		for (auto &counter : s.counters) {
+			counter.store(0, std::memory_order_relaxed);
+		}
+		for (auto &gauge : s.gauges) {
+			gauge.store(0, std::memory_order_relaxed);
+		}
+		for (size_t h = 0; h < HISTOGRAM_COUNT; h++) {
+			s.sums[h].store(0, std::memory_order_relaxed);
+			for (auto &bucket : s.buckets[h]) {
+				bucket.store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+}
+
+PipelineMetrics::~PipelineMetrics() {}
+
+size_t PipelineMetrics::threadShard()
+{
+	thread_local size_t index = next_shard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+	return index;
+}
+
+size_t PipelineMetrics::bucketIndex(uint64_t value)
+{
+	if (value < SUB_BUCKETS) {
+		return (size_t)value;
+	}
+	value = std::min(value, (uint64_t(1) << MAX_VALUE_BITS) - 1);
+
+	// The top bit picks the power of two, the next SUB_BUCKET_BITS bits the linear step within it
+	unsigned top = highest_bit(value);
+	size_t shift = top - SUB_BUCKET_BITS;
+	size_t sub = (size_t)(value >> shift) & (SUB_BUCKETS - 1);
+	return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t PipelineMetrics::bucketUpperBound(size_t index)
+{
+	if (index < SUB_BUCKETS) {
+		return index;
+	}
+	size_t shift = index / SUB_BUCKETS - 1;
+	uint64_t lower = (uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+	return lower + (uint64_t(1) << shift) - 1;
+}
+
+uint64_t PipelineMetrics::HistogramSnapshot::percentile(double q) const
+{
+	if (count == 0 || buckets.empty()) {
+		return 0;
+	}
+
+	// Rank of the recording sought, counting from 1
+	uint64_t rank = (uint64_t)std::ceil(std::clamp(q, 0.0, 1.0) * count);
+	rank = std::max<uint64_t>(rank, 1);
+	uint64_t seen = 0;
+	for (size_t i = 0; i < buckets.size(); i++) {
+		seen += buckets[i];
+		if (seen >= rank) {
+			return bucketUpperBound(i);
+		}
+	}
+	return 0;
+}
+
+PipelineMetrics::HistogramSnapshot PipelineMetrics::HistogramSnapshot::since(const HistogramSnapshot &earlier) const
+{
+	HistogramSnapshot result = *this;
+	if (earlier.buckets.size() != buckets.size()) {
+		return result;
+	}
+	result.count -= std::min(earlier.count, count);
+	result.sum -= std::min(earlier.sum, sum);
+	for (size_t i = 0; i < buckets.size(); i++) {
+		result.buckets[i] -= std::min(earlier.buckets[i], buckets[i]);
+	}
+	return result;
+}
+
+PipelineMetrics::Snapshot PipelineMetrics::snapshot() const
+{
+	Snapshot result;
+	result.takenAt = os_gettime_ns();
+	for (HistogramSnapshot &histogram : result.histograms) {
+		histogram.buckets.assign(BUCKETS, 0);
+	}
+
+	for (size_t i = 0; i < SHARD_COUNT; i++) {
+		const Shard &s = shards[i];
+		for (size_t c = 0; c < COUNTER_COUNT; c++) {
+			result.counters[c] += s.counters[c].load(std::memory_order_relaxed);
+		}
+		for (size_t g = 0; g < GAUGE_COUNT; g++) {
+			result.gauges[g] += s.gauges[g].load(std::memory_order_relaxed);
+		}
+		for (size_t h = 0; h < HISTOGRAM_COUNT; h++) {
+			HistogramSnapshot &histogram = result.histograms[h];
+			histogram.sum += s.sums[h].load(std::memory_order_relaxed);
+			for (size_t b = 0; b < BUCKETS; b++) {
+				uint64_t n = s.buckets[h][b].load(std::memory_order_relaxed);
+				histogram.buckets[b] += n;
+				histogram.count += n;
+			}
+		}
+	}
+
+	// A gauge's increments and decrements may sit in different shards and be read a moment apart
+	for (int64_t &gauge : result.gauges) {
+		gauge = std::max<int64_t>(gauge, 0);
+	}
+	return result;
+}
+
+const char *PipelineMetrics::name(Counter counter)
+{
+	switch (counter) {
+	case MessagesReceived:
+		return "messages_received";
+	case ParseErrors:
+		return "parse_errors";
+	case CaptionsEmitted:
+		return "captions_emitted";
+	case BytesIn:
+		return "bytes_in";
+	case BytesOut:
+		return "bytes_out";
+	case AudioDropped:
+		return "audio_dropped";
+	case Connects:
+		return "connects";
+	case Disconnects:
+		return "disconnects";
+	default:
+		return "unknown";
+	}
+}
+
+const char *PipelineMetrics::name(Gauge gauge)
+{
+	switch (gauge) {
+	case QueueDepth:
+		return "queue_depth";
+	default:
+		return "unknown";
+	}
+}
+
+const char *PipelineMetrics::name(Histogram histogram)
+{
+	switch (histogram) {
+	case ParseTime:
+		return "parse_time_us";
+	case ComposeTime:
+		return "compose_time_us";
+	case CaptionLatency:
+		return "caption_latency_us";
+	default:
+		return "unknown";
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Counters, gauges and latency histograms for the caption pipeline, cheap
+// enough to record from the network, worker and graphics threads on every
+// message.
+//
+// Every metric is spread over a few cache-line-aligned shards, and each
+// thread records into the shard it was assigned on first use, so threads
+// rarely share a cache line. Recording is a single relaxed atomic add: no
+// locks, no allocation, no compare-and-swap loops. Shards are only summed
+// when a snapshot is taken, which is the one place that pays for the
+// aggregation.
+//
+// Histograms are HDR-style: each power of two is split into 16 linear
+// sub-buckets, so any recorded value lands in a bucket within about 6% of
+// it, from 1 µs up to hours, in a fixed 528 buckets.
+class PipelineMetrics {
+public:
+	enum Counter {
+		MessagesReceived, // Messages and segments handed over by the backends
+		ParseErrors,
+		CaptionsEmitted, // New captions taken by the emitter
+		BytesIn,
+		BytesOut,     // Control messages and uplink audio
+		AudioDropped, // Uplink payloads the backend did not take
+		Connects,
+		Disconnects,
+		COUNTER_COUNT
+	};
+
+	enum Gauge {
+		QueueDepth, // Messages waiting on the worker queues
+		GAUGE_COUNT
+	};
+
+	enum Histogram {
+		ParseTime,      // µs to parse one message
+		ComposeTime,    // µs to ingest one message into the caption pipeline
+		CaptionLatency, // µs from receiving a message to emitting its caption
+		HISTOGRAM_COUNT
+	};
+
+	static constexpr size_t SUB_BUCKET_BITS = 4;
+	static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+	// Values are clamped below 2^36 µs, about 19 hours
+	static constexpr size_t MAX_VALUE_BITS = 36;
+	static constexpr size_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	struct HistogramSnapshot {
+		uint64_t count = 0;
+		uint64_t sum = 0;
+		std::vector<uint64_t> buckets; // BUCKETS entries, see bucketUpperBound()
+
+		// Value at or below which the fraction q (0-1) of recordings fall, to bucket precision; 0 if empty
+		uint64_t percentile(double q) const;
+		double mean() const { return count ? (double)sum / count : 0.0; }
+		// Recordings made after an earlier snapshot of the same histogram
+		HistogramSnapshot since(const HistogramSnapshot &earlier) const;
+	};
+
+	struct Snapshot {
+		uint64_t takenAt = 0; // os_gettime_ns()
+		uint64_t counters[COUNTER_COUNT] = {};
+		int64_t gauges[GAUGE_COUNT] = {};
+		HistogramSnapshot histograms[HISTOGRAM_COUNT];
+	};
+
+	PipelineMetrics();
+	~PipelineMetrics();
+
+	PipelineMetrics(const PipelineMetrics &) = delete;
+	PipelineMetrics &operator=(const PipelineMetrics &) = delete;
+
+	// Hot path: any thread, never blocks
+	void add(Counter counter, uint64_t amount = 1)
+	{
+		shard().counters[counter].fetch_add(amount, std::memory_order_relaxed);
+	}
+	void adjust(Gauge gauge, int64_t delta)
+	{
+		shard().gauges[gauge].fetch_add(delta, std::memory_order_relaxed);
+	}
+	void record(Histogram histogram, uint64_t value)
+	{
+		Shard &s = shard();
+		s.buckets[histogram][bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		s.sums[histogram].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	// Sums every shard; shards keep being written meanwhile, so metrics may be a few recordings apart
+	Snapshot snapshot() const;
+
+	static size_t bucketIndex(uint64_t value);
+	// Largest value that lands in the bucket
+	static uint64_t bucketUpperBound(size_t index);
+
+	// Stable snake_case names, with the unit where there is one, for logs and exports
+	static const char *name(Counter counter);
+	static const char *name(Gauge gauge);
+	static const char *name(Histogram histogram);
+
+private:
+	static constexpr size_t SHARD_COUNT = 8;
+
+	struct alignas(64) Shard {
+		std::atomic<uint64_t> counters[COUNTER_COUNT];
+		std::atomic<int64_t> gauges[GAUGE_COUNT];
+		std::atomic<uint64_t> sums[HISTOGRAM_COUNT];
+		std::atomic<uint64_t> buckets[HISTOGRAM_COUNT][BUCKETS];
+	};
+
+	Shard &shard() { return shards[threadShard()]; }
+	static size_t threadShard();
+
+	std::unique_ptr<Shard[]> shards;
+};
@@ -0,0 +1,170 @@
+#include "pipeline-tracer.h"
+#include <util/platform.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+// Sets tracer instances apart in the per-thread ring cache
+static std::atomic<uint64_t> next_generation{1};
+
+static const char *thread_role(PipelineTracer::Stage stage, PipelineTracer::Phase phase)
+{
+	switch (stage) {
+	case PipelineTracer::Receive:
+		return "Backend";
+	case PipelineTracer::Queue:
+		return phase == PipelineTracer::Begin ? "Backend" : "Worker";
+	case PipelineTracer::Hold:
+		return phase == PipelineTracer::Begin ? "Worker" : "Graphics tick";
+	case PipelineTracer::Emit:
+		return "Graphics tick";
+	default:
+		return "Worker";
+	}
+}
+
+// Queue and Hold start on one thread and end on another, so they are async events matched by id
+static bool is_async(PipelineTracer::Stage stage)
+{
+	return stage == PipelineTracer::Queue || stage == PipelineTracer::Hold;
+}
+
+PipelineTracer::PipelineTracer() : active(false), generation(next_generation.fetch_add(1)) {}
+
+PipelineTracer::~PipelineTracer() {}
+
+void PipelineTracer::setEnabled(bool enabled)
+{
+	active.store(enabled, std::memory_order_relaxed);
+}
+
+const char *PipelineTracer::name(Stage stage)
+{
+	switch (stage) {
+	case Receive:
+		return "Receive";
+	case Queue:
+		return "Queue";
+	case Parse:
+		return "Parse";
+	case Compose:
+		return "Compose";
+	case Throttle:
+		return "Throttle";
+	case Hold:
+		return "Hold";
+	case Emit:
+		return "Emit";
+	default:
+		return "Unknown";
+	}
+}
+
+PipelineTracer::ThreadRing *PipelineTracer::threadRing(Stage stage, Phase phase)
+{
+	thread_local ThreadRing *cached = nullptr;
+	thread_local uint64_t cachedGeneration = 0;
+	if (cachedGeneration == generation) {
+		return cached;
+	}
+
+	// First event from this thread: the only time recording takes the lock or allocates
+	std::unique_ptr<ThreadRing> ring = std::make_unique<ThreadRing>();
+	ring->role = thread_role(stage, phase);
+	std::lock_guard<std::mutex> lock(mutex);
+	ring->tid = (int)rings.size() + 1;
+	cached = ring.get();
+	cachedGeneration = generation;
+	rings.push_back(std::move(ring));
+	return cached;
+}
+
+void PipelineTracer::write(Stage stage, Phase phase, int service, uint64_t message, double segment)
+{
+	ThreadRing *ring = threadRing(stage, phase);
+	uint64_t index = ring->written.load(std::memory_order_relaxed);
+	Event &event = ring->events[index % RING_EVENTS];
+
+	// Readers skip the slot until its sequence names this event
+	event.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	event.timestamp.store(os_gettime_ns(), std::memory_order_relaxed);
+	event.message.store(message, std::memory_order_relaxed);
+	event.segment.store(segment, std::memory_order_relaxed);
+	event.kind.store((uint32_t)stage << 24 | (uint32_t)phase << 16 | ((uint32_t)service & 0xffff),
+			 std::memory_order_relaxed);
+	event.sequence.store(index + 1, std::memory_order_release);
+	ring->written.store(index + 1, std::memory_order_release);
+}
+
+void PipelineTracer::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto &ring : rings) {
+		ring->clearedAt.store(ring->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+	}
+}
+
+std::string PipelineTracer::chromeTrace() const
+{
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	char line[512];
+	bool first = true;
+	auto append = [&]() {
+		json += first ? "\n" : ",\n";
+		json += line;
+		first = false;
+	};
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const auto &ring : rings) {
+		snprintf(line, sizeof(line),
+			 "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+			 ring->tid, ring->role);
+		append();
+
+		uint64_t written = ring->written.load(std::memory_order_acquire);
+		uint64_t start = std::max(ring->clearedAt.load(std::memory_order_relaxed),
+					  written > RING_EVENTS ? written - RING_EVENTS : 0);
+		for (uint64_t index = start; index < written; index++) {
+			const Event &event = ring->events[index % RING_EVENTS];
+			if (event.sequence.load(std::memory_order_acquire) != index + 1) {
+				continue;
+			}
+			uint64_t timestamp = event.timestamp.load(std::memory_order_relaxed);
+			uint64_t message = event.message.load(std::memory_order_relaxed);
+			double segment = event.segment.load(std::memory_order_relaxed);
+			uint32_t kind = event.kind.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (event.sequence.load(std::memory_order_relaxed) != index + 1) {
+				continue; // Overwritten while it was read
+			}
+
+			Stage stage = (Stage)(kind >> 24);
+			Phase phase = (Phase)((kind >> 16) & 0xff);
+			int service = (int)(kind & 0xffff);
+			const char *ph = phase == Instant ? "i" : phase == Begin ? "B" : "E";
+			char id[64] = "";
+			if (is_async(stage) && phase != Instant) {
+				ph = phase == Begin ? "b" : "e";
+				// Each message is queued once and composes into at most one held caption
+				snprintf(id, sizeof(id), ",\"id\":\"cs%d-%c%" PRIu64 "\"", service,
+					 stage == Queue ? 'q' : 'h', message);
+			}
+			char segmentArg[48] = "";
+			if (segment != NO_SEGMENT) {
+				snprintf(segmentArg, sizeof(segmentArg), ",\"segment\":%.15g", segment);
+			}
+			snprintf(line, sizeof(line),
+				 "{\"name\":\"%s\",\"cat\":\"caption\",\"ph\":\"%s\"%s%s,\"ts\":%.3f,"
+				 "\"pid\":1,\"tid\":%d,\"args\":{\"service\":%d,\"message\":%" PRIu64 "%s}}",
+				 name(stage), ph, id, phase == Instant ? ",\"s\":\"t\"" : "", timestamp / 1000.0,
+				 ring->tid, service, message, segmentArg);
+			append();
+		}
+	}
+
+	json += "\n]}\n";
+	return json;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Optional trace of each caption's path through the pipeline, exported as
+// Chrome trace-event JSON for chrome://tracing or Perfetto.
+//
+// Stages are recorded as begin/end pairs tagged with the caption service,
+// the track's message number and the segment id, so a late caption can be
+// followed from arrival on the network thread through the worker queue,
+// parsing, composition (including partials held back by the 500 ms
+// throttle), the wait for its send slot and emission on the graphics tick.
+//
+// Each thread records into its own fixed ring of the most recent events,
+// allocated the first time it records while tracing is on; older events are
+// overwritten. Recording takes no lock: the owning thread is the only
+// writer, and a per-slot sequence number lets a dump skip any slot that is
+// being rewritten while it is read. With tracing off, recording is a single
+// relaxed load.
+class PipelineTracer {
+public:
+	enum Stage {
+		Receive,   // Message handed over by the backend (instant, network thread)
+		Queue,     // Waiting for a worker (async: network thread to worker)
+		Parse,     // JSON parsing
+		Compose,   // Ingesting into the caption pipeline
+		Throttle,  // Changed partial held back by the 500 ms limit (instant)
+		Hold,      // Composed caption waiting for its send slot (async: worker to graphics tick)
+		Emit,      // Sending to the outputs
+		STAGE_COUNT
+	};
+
+	enum Phase : uint8_t {
+		Begin,
+		End,
+		Instant,
+	};
+
+	// Segment id of events recorded before the message was parsed, or for untagged captions
+	static constexpr double NO_SEGMENT = -1.0;
+	// Events kept per thread
+	static constexpr size_t RING_EVENTS = 8192;
+
+	PipelineTracer();
+	~PipelineTracer();
+
+	PipelineTracer(const PipelineTracer &) = delete;
+	PipelineTracer &operator=(const PipelineTracer &) = delete;
+
+	void setEnabled(bool enabled);
+	bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+	// Hot path: any thread, never blocks once the thread has its ring
+	void record(Stage stage, Phase phase, int service, uint64_t message, double segment = NO_SEGMENT)
+	{
+		if (enabled()) {
+			write(stage, phase, service, message, segment);
+		}
+	}
+
+	// Chrome trace JSON of every event still held, oldest first per thread
+	std::string chromeTrace() const;
+	// Drops every recorded event; rings stay allocated
+	void clear();
+
+	static const char *name(Stage stage);
+
+private:
+	struct Event {
+		// Index + 1 once the slot holds event index, 0 while it is being written
+		std::atomic<uint64_t> sequence{0};
+		std::atomic<uint64_t> timestamp{0};
+		std::atomic<uint64_t> message{0};
+		std::atomic<double> segment{NO_SEGMENT};
+		std::atomic<uint32_t> kind{0}; // stage << 24 | phase << 16 | service
+	};
+
+	struct ThreadRing {
+		int tid = 0;
+		const char *role = ""; // Thread name in the trace, from the first stage it recorded
+		std::atomic<uint64_t> written{0};
+		std::atomic<uint64_t> clearedAt{0};
+		Event events[RING_EVENTS];
+	};
+
+	void write(Stage stage, Phase phase, int service, uint64_t message, double segment);
+	ThreadRing *threadRing(Stage stage, Phase phase);
+
+	std::atomic<bool> active;
+	uint64_t generation; // Tells this tracer's rings apart from an earlier instance's
+
+	// Only taken the first time a thread records, and to dump
+	mutable std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadRing>> rings;
+};
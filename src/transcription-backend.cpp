@@ -0,0 +1,46 @@
+#include "transcription-backend.h"
+#include "websocket-backend.h"
+#ifdef ENABLE_WHISPER
+#include "whisper-backend.h"
+#endif
+
+#include <cstring>
+
+static bool has_scheme(const std::string &url, const char *scheme)
+{
+	return url.compare(0, strlen(scheme), scheme) == 0;
+}
+
+bool TranscriptionBackend::supportsUrl(const std::string &url, std::string &error)
+{
+	if (has_scheme(url, "ws://") || has_scheme(url, "wss://")) {
+		return true;
+	}
+	if (has_scheme(url, "whisper://")) {
+#ifdef ENABLE_WHISPER
+		if (url.size() > strlen("whisper://")) {
+			return true;
+		}
+		error = "whisper:// needs a model path";
+#else
+		error = "This build has no in-process transcription (ENABLE_WHISPER)";
+#endif
+		return false;
+	}
+	error = "URL must start with ws:// or wss://";
+	return false;
+}
+
+std::unique_ptr<TranscriptionBackend> TranscriptionBackend::create(const std::string &url)
+{
+	std::string error;
+	if (!supportsUrl(url, error)) {
+		return nullptr;
+	}
+#ifdef ENABLE_WHISPER
+	if (has_scheme(url, "whisper://")) {
+		return std::make_unique<WhisperBackend>(url);
+	}
+#endif
+	return std::make_unique<WebSocketBackend>(url);
+}
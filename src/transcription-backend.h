@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace asio {
+class io_context;
+}
+
+// Where a caption track's transcripts come from.
+//
+// A backend takes the uplink's audio streams and hands back transcript
+// segments. Network backends deliver them as protocol messages for the track
+// to parse; in-process backends deliver finished Segments directly, skipping
+// serialization altogether. Either way a segment means the same thing: the
+// latest text for an id, partial until is_final, possibly tagged with the
+// audio stream it was heard on.
+//
+// Handlers are invoked from the backend's own threads.
+class TranscriptionBackend {
+public:
+	struct Segment {
+		double id = 0.0;
+		std::string text;
+		bool isFinal = true;
+		bool isRevision = false; // The id was sent before
+		std::string source;      // Tag of the audio stream, empty when untagged
+	};
+
+	// Describes one audio uplink stream before its first payload
+	struct AudioFormat {
+		uint8_t stream = 0;
+		std::string source;
+		const char *encoding = "s16le"; // As named by AudioEncoder::formatName()
+		int packetMs = 0;               // Opus only
+		int bitrate = 0;                // Opus only
+		uint32_t sampleRate = 0;
+		int frameMs = 0;
+		int framesPerMessage = 0;
+		bool voiceGating = false;
+	};
+
+	typedef std::function<void(bool connected)> ConnectHandler;
+	typedef std::function<void(const char *message, size_t len)> MessageHandler;
+	typedef std::function<void(const Segment &segment)> SegmentHandler;
+	typedef void (*Task)(void *param);
+
+	virtual ~TranscriptionBackend() = default;
+
+	// Picks the implementation for the URL: ws:// and wss:// servers, or whisper:// model files
+	static std::unique_ptr<TranscriptionBackend> create(const std::string &url);
+	// Whether create() would accept the URL scheme; error says why not
+	static bool supportsUrl(const std::string &url, std::string &error);
+
+	void setConnectHandler(ConnectHandler handler) { connectHandler = std::move(handler); }
+	void setMessageHandler(MessageHandler handler) { messageHandler = std::move(handler); }
+	void setSegmentHandler(SegmentHandler handler) { segmentHandler = std::move(handler); }
+
+	virtual bool connect() = 0;
+	virtual void disconnect() = 0;
+	virtual bool isConnected() const = 0;
+	// Session control such as start_transcription or ping; meaningless in process
+	virtual void sendControl(const char *json) = 0;
+
+	// Audio uplink; only called from the backend's timer task
+	virtual bool acceptsOpus() const = 0;
+	virtual void startAudio(const AudioFormat &format) = 0;
+	virtual bool sendAudio(uint8_t stream, const uint8_t *payload, size_t size) = 0;
+	virtual void markSpeech(uint8_t stream, bool speaking) = 0;
+	virtual void stopAudio(uint8_t stream) = 0;
+	// Runs task every intervalMs on a backend thread; a null task stops it
+	virtual bool setTimer(Task task, void *param, int intervalMs) = 0;
+	// The asio io_context of the backend's network thread, for other asio work to share;
+	// nullptr for backends without one. Valid from connect() until the backend is destroyed.
+	virtual asio::io_context *networkContext() { return nullptr; }
+
+protected:
+	ConnectHandler connectHandler;
+	MessageHandler messageHandler;
+	SegmentHandler segmentHandler;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// Minimal UTF-8 helpers shared by the caption layout and encoding code.
+
+constexpr uint32_t UTF8_REPLACEMENT = 0xFFFD;
+
+// Decodes one sequence and advances p, substituting U+FFFD for malformed input
+inline uint32_t utf8_next(const char *&p, const char *end)
+{
+	uint8_t c = (uint8_t)*p++;
+	if (c < 0x80) {
+		return c;
+	}
+
+	int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : -1;
+	if (extra < 0 || end - p < extra) {
+		return UTF8_REPLACEMENT;
+	}
+
+	uint32_t cp = c & (0x3F >> extra);
+	for (int i = 0; i < extra; i++) {
+		uint8_t cont = (uint8_t)*p;
+		if ((cont & 0xC0) != 0x80) {
+			return UTF8_REPLACEMENT;
+		}
+		cp = (cp << 6) | (cont & 0x3F);
+		p++;
+	}
+	return cp;
+}
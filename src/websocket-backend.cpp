@@ -0,0 +1,135 @@
+#include "websocket-backend.h"
+#include "websocket-client.h"
+#include "cJSON.h"
+#include <obs-module.h>
+#include "plugin-support.h"
+
+#include <cstdio>
+
+WebSocketBackend::WebSocketBackend(const std::string &url) : url(url), client(nullptr) {}
+
+WebSocketBackend::~WebSocketBackend()
+{
+	// Joins the network thread, so no handler runs after this
+	if (client) {
+		websocket_client_destroy(client);
+		client = nullptr;
+	}
+}
+
+bool WebSocketBackend::connect()
+{
+	if (client) {
+		websocket_client_destroy(client);
+		client = nullptr;
+	}
+
+	client = websocket_client_create(url.c_str());
+	if (!client) {
+		obs_log(LOG_ERROR, "[Entei] Failed to create WebSocket client for %s", url.c_str());
+		return false;
+	}
+
+	websocket_client_set_connect_callback(client, websocket_connect_callback, this);
+	websocket_client_set_message_callback(client, websocket_message_callback, this);
+
+	return websocket_client_connect(client);
+}
+
+void WebSocketBackend::disconnect()
+{
+	if (client) {
+		websocket_client_disconnect(client);
+	}
+}
+
+bool WebSocketBackend::isConnected() const
+{
+	return websocket_client_is_connected(client);
+}
+
+void WebSocketBackend::sendControl(const char *json)
+{
+	if (client) {
+		websocket_client_send(client, json);
+	}
+}
+
+void WebSocketBackend::startAudio(const AudioFormat &format)
+{
+	cJSON *start = cJSON_CreateObject();
+	cJSON_AddStringToObject(start, "type", "start_audio");
+	cJSON_AddNumberToObject(start, "stream", format.stream);
+	cJSON_AddStringToObject(start, "source", format.source.c_str());
+	cJSON_AddStringToObject(start, "format", format.encoding);
+	if (format.packetMs > 0) {
+		cJSON_AddNumberToObject(start, "packet_ms", format.packetMs);
+		cJSON_AddNumberToObject(start, "bitrate", format.bitrate);
+	}
+	cJSON_AddNumberToObject(start, "channels", 1);
+	cJSON_AddNumberToObject(start, "sample_rate", format.sampleRate);
+	cJSON_AddNumberToObject(start, "frame_ms", format.frameMs);
+	cJSON_AddNumberToObject(start, "frames_per_message", format.framesPerMessage);
+	cJSON_AddBoolToObject(start, "voice_gating", format.voiceGating);
+	char *json = cJSON_PrintUnformatted(start);
+	if (json) {
+		sendControl(json);
+		cJSON_free(json);
+	}
+	cJSON_Delete(start);
+}
+
+bool WebSocketBackend::sendAudio(uint8_t stream, const uint8_t *payload, size_t size)
+{
+	if (!client) {
+		return false;
+	}
+
+	// Every message starts with the id of the stream it belongs to
+	frame.assign(1, stream);
+	frame.insert(frame.end(), payload, payload + size);
+	return websocket_client_send_binary(client, frame.data(), frame.size());
+}
+
+void WebSocketBackend::markSpeech(uint8_t stream, bool speaking)
+{
+	sendStreamMessage(stream, speaking ? "speech_start" : "speech_end");
+}
+
+void WebSocketBackend::stopAudio(uint8_t stream)
+{
+	sendStreamMessage(stream, "stop_audio");
+}
+
+bool WebSocketBackend::setTimer(Task task, void *param, int intervalMs)
+{
+	return client && websocket_client_set_timer(client, task, param, intervalMs);
+}
+
+asio::io_context *WebSocketBackend::networkContext()
+{
+	return websocket_client_io_context(client);
+}
+
+void WebSocketBackend::sendStreamMessage(uint8_t stream, const char *type)
+{
+	char json[64];
+	snprintf(json, sizeof(json), "{\"type\":\"%s\",\"stream\":%u}", type, (unsigned)stream);
+	sendControl(json);
+}
+
+void WebSocketBackend::websocket_connect_callback(bool connected, void *user_data)
+{
+	WebSocketBackend *backend = static_cast<WebSocketBackend *>(user_data);
+	if (backend && backend->connectHandler) {
+		backend->connectHandler(connected);
+	}
+}
+
+void WebSocketBackend::websocket_message_callback(const char *message, size_t len, void *user_data)
+{
+	WebSocketBackend *backend = static_cast<WebSocketBackend *>(user_data);
+	if (backend && message && backend->messageHandler) {
+		backend->messageHandler(message, len);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include "transcription-backend.h"
+
+struct websocket_client;
+
+// Transcription by an external server over the caption WebSocket.
+//
+// Audio streams are announced with a "start_audio" message and sent as
+// binary messages that start with the stream id; speech markers and
+// "stop_audio" are JSON messages carrying the same id. Transcripts come back
+// as "transcription" messages for the track to parse.
+class WebSocketBackend : public TranscriptionBackend {
+public:
+	explicit WebSocketBackend(const std::string &url);
+	~WebSocketBackend() override;
+
+	bool connect() override;
+	void disconnect() override;
+	bool isConnected() const override;
+	void sendControl(const char *json) override;
+
+	bool acceptsOpus() const override { return true; }
+	void startAudio(const AudioFormat &format) override;
+	bool sendAudio(uint8_t stream, const uint8_t *payload, size_t size) override;
+	void markSpeech(uint8_t stream, bool speaking) override;
+	void stopAudio(uint8_t stream) override;
+	bool setTimer(Task task, void *param, int intervalMs) override;
+	asio::io_context *networkContext() override;
+
+private:
+	void sendStreamMessage(uint8_t stream, const char *type);
+
+	static void websocket_connect_callback(bool connected, void *user_data);
+	static void websocket_message_callback(const char *message, size_t len, void *user_data);
+
+	std::string url;
+	struct websocket_client *client;
+	std::vector<uint8_t> frame; // Stream id and payload; only used from the timer task
+};
@@ -9,6 +9,7 @@
 #include <memory>
 #include <string>
 #include <mutex>
+#include <chrono>
 
 typedef websocketpp::client<websocketpp::config::asio> ws_client_t;
 typedef websocketpp::config::asio::message_type::ptr message_ptr;
@@ -34,6 +35,13 @@ struct websocket_client {
 	void *connect_user_data;
 
 	std::mutex callback_mutex;
+
+	// Periodic task on the network thread; only touched from that thread
+	std::unique_ptr<asio::steady_timer> timer;
+	websocket_task_t timer_task;
+	void *timer_param;
+	std::chrono::milliseconds timer_interval;
+	uint64_t timer_generation;
 };
 
 static bool parse_url(const std::string &url, std::string &host, std::string &path, int &port)
@@ -87,6 +95,10 @@ struct websocket_client *websocket_client_create(const char *url)
 	client->message_user_data = nullptr;
 	client->connect_callback = nullptr;
 	client->connect_user_data = nullptr;
+	client->timer_task = nullptr;
+	client->timer_param = nullptr;
+	client->timer_interval = std::chrono::milliseconds(0);
+	client->timer_generation = 0;
 
 	if (!parse_url(client->url, client->host, client->path, client->port)) {
 		obs_log(LOG_ERROR, "Failed to parse WebSocket URL: %s", url);
@@ -152,6 +164,7 @@ void websocket_client_destroy(struct websocket_client *client)
 
 	// Clear smart pointers in proper order
 	client->worker_thread.reset();
+	client->timer.reset();
 	client->ws_client.reset();
 	client->io_context.reset();
 
@@ -167,6 +180,8 @@ bool websocket_client_connect(struct websocket_client *client)
 	}
 
 	try {
+		// A timer belongs to the previous io_context
+		client->timer.reset();
 		client->io_context = std::make_unique<asio::io_context>();
 
 		client->ws_client = std::make_unique<ws_client_t>();
@@ -297,6 +312,77 @@ void websocket_client_send(struct websocket_client *client, const char *message)
 	}
 }
 
+bool websocket_client_send_binary(struct websocket_client *client, const void *data, size_t size)
+{
+	// Called for every audio batch, so nothing is logged on success
+	if (!client || !data || !client->connected || !client->ws_client) {
+		return false;
+	}
+
+	try {
+		websocketpp::lib::error_code ec;
+		client->ws_client->send(client->connection_hdl, data, size, websocketpp::frame::opcode::binary, ec);
+		if (ec) {
+			obs_log(LOG_ERROR, "Failed to send WebSocket binary message: %s", ec.message().c_str());
+			return false;
+		}
+		return true;
+
+	} catch (const std::exception &e) {
+		obs_log(LOG_ERROR, "WebSocket binary send exception: %s", e.what());
+		return false;
+	}
+}
+
+asio::io_context *websocket_client_io_context(struct websocket_client *client)
+{
+	return client ? client->io_context.get() : nullptr;
+}
+
+static void schedule_timer(struct websocket_client *client, uint64_t generation)
+{
+	client->timer->expires_after(client->timer_interval);
+	client->timer->async_wait([client, generation](const std::error_code &ec) {
+		// A replaced or cancelled timer may still complete once
+		if (ec || generation != client->timer_generation || !client->timer_task) {
+			return;
+		}
+		client->timer_task(client->timer_param);
+		schedule_timer(client, generation);
+	});
+}
+
+bool websocket_client_set_timer(struct websocket_client *client, websocket_task_t task, void *param,
+				int interval_ms)
+{
+	// Runs task every interval_ms on the network thread; a null task stops it.
+	// Used to move audio encoding and sending off the OBS audio thread.
+	if (!client || !client->io_context) {
+		return false;
+	}
+
+	try {
+		asio::post(*client->io_context, [client, task, param, interval_ms]() {
+			if (!client->timer) {
+				client->timer = std::make_unique<asio::steady_timer>(*client->io_context);
+			}
+			client->timer->cancel();
+			client->timer_generation++;
+			client->timer_task = task;
+			client->timer_param = param;
+			client->timer_interval = std::chrono::milliseconds(interval_ms);
+			if (task && interval_ms > 0) {
+				schedule_timer(client, client->timer_generation);
+			}
+		});
+		return true;
+
+	} catch (const std::exception &e) {
+		obs_log(LOG_ERROR, "WebSocket timer exception: %s", e.what());
+		return false;
+	}
+}
+
 void websocket_client_set_message_callback(struct websocket_client *client, websocket_message_callback_t callback,
 					   void *user_data)
 {
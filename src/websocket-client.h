@@ -11,6 +11,7 @@ struct websocket_client;
 
 typedef void (*websocket_message_callback_t)(const char *message, size_t len, void *user_data);
 typedef void (*websocket_connect_callback_t)(bool connected, void *user_data);
+typedef void (*websocket_task_t)(void *param);
 
 struct websocket_client *websocket_client_create(const char *url);
 void websocket_client_destroy(struct websocket_client *client);
@@ -18,6 +19,9 @@ bool websocket_client_connect(struct websocket_client *client);
 void websocket_client_disconnect(struct websocket_client *client);
 bool websocket_client_is_connected(struct websocket_client *client);
 void websocket_client_send(struct websocket_client *client, const char *message);
+bool websocket_client_send_binary(struct websocket_client *client, const void *data, size_t size);
+bool websocket_client_set_timer(struct websocket_client *client, websocket_task_t task, void *param,
+				int interval_ms);
 void websocket_client_set_message_callback(struct websocket_client *client, websocket_message_callback_t callback,
 					   void *user_data);
 void websocket_client_set_connect_callback(struct websocket_client *client, websocket_connect_callback_t callback,
@@ -25,4 +29,13 @@ void websocket_client_set_connect_callback(struct websocket_client *client, webs
 
 #ifdef __cplusplus
 }
+
+namespace asio {
+class io_context;
+}
+
+// The io_context the network thread runs, so other asio work can share that
+// thread. Replaced by each websocket_client_connect and destroyed with the
+// client; nullptr before the first connect.
+asio::io_context *websocket_client_io_context(struct websocket_client *client);
 #endif
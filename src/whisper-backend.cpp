@@ -0,0 +1,437 @@
+#include "whisper-backend.h"
+#include <obs-module.h>
+#include "plugin-support.h"
+
+#include <whisper.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static const uint32_t WHISPER_RATE = 16000;
+
+// A partial transcript is refreshed once this much new audio has arrived
+static const size_t STEP_SAMPLES = WHISPER_RATE;
+// Utterances are finalized at this length even without a pause
+static const size_t MAX_UTTERANCE_SAMPLES = WHISPER_RATE * 10;
+// whisper.cpp skips anything shorter than a second; pad with silence past that
+static const size_t MIN_WINDOW_SAMPLES = WHISPER_RATE * 105 / 100;
+
+static std::string trim_transcript(const char *text)
+{
+	std::string result(text ? text : "");
+	size_t start = result.find_first_not_of(" \t\n");
+	size_t end = result.find_last_not_of(" \t\n");
+	if (start == std::string::npos) {
+		return std::string();
+	}
+	result = result.substr(start, end - start + 1);
+
+	// Non-speech annotations such as "[BLANK_AUDIO]" or "(music)" are not captions
+	char first = result.front();
+	char last = result.back();
+	if ((first == '[' && last == ']') || (first == '(' && last == ')')) {
+		return std::string();
+	}
+	return result;
+}
+
+WhisperBackend::WhisperBackend(const std::string &url)
+	: language("en"),
+	  context(nullptr),
+	  aborting(false),
+	  running(false),
+	  connected(false),
+	  lastDecoded(0),
+	  timerTask(nullptr),
+	  timerParam(nullptr),
+	  timerInterval(0)
+{
+	// whisper://<model path>[?lang=<code>]
+	std::string rest = url.substr(std::min(url.size(), strlen("whisper://")));
+	size_t query = rest.find('?');
+	modelPath = rest.substr(0, query);
+	if (query != std::string::npos) {
+		std::string params = rest.substr(query + 1);
+		if (params.compare(0, 5, "lang=") == 0) {
+			language = params.substr(5, params.find('&') - 5);
+		}
+	}
+}
+
+WhisperBackend::~WhisperBackend()
+{
+	stopThreads();
+}
+
+bool WhisperBackend::connect()
+{
+	stopThreads();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = true;
+		streams.clear();
+	}
+	aborting.store(false);
+
+	// Loading takes seconds and cannot be interrupted, so it gets a thread nobody joins
+	modelLoad = std::make_shared<ModelLoad>();
+	std::thread(&WhisperBackend::loadModel, modelLoad, modelPath).detach();
+	decoder = std::thread(&WhisperBackend::decodeLoop, this, modelLoad);
+	timer = std::thread(&WhisperBackend::timerLoop, this);
+	return true;
+}
+
+void WhisperBackend::disconnect()
+{
+	bool wasConnected = isConnected();
+	stopThreads();
+	if (wasConnected && connectHandler) {
+		connectHandler(false);
+	}
+}
+
+bool WhisperBackend::isConnected() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return connected;
+}
+
+void WhisperBackend::sendControl(const char *json)
+{
+	// No session to start or keep alive
+	UNUSED_PARAMETER(json);
+}
+
+void WhisperBackend::startAudio(const AudioFormat &format)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	// A restarted stream keeps counting segments, so new text never revises old captions
+	Stream &stream = streams[format.stream];
+	double segmentId = stream.segmentId + (stream.partialSent ? 1.0 : 0.0);
+	uint64_t generation = stream.generation + 1;
+	stream = Stream();
+	stream.segmentId = segmentId;
+	stream.generation = generation;
+	stream.source = format.source;
+	stream.usable = strcmp(format.encoding, "s16le") == 0 && format.sampleRate == WHISPER_RATE;
+	if (!stream.usable) {
+		obs_log(LOG_WARNING, "[Entei] Whisper needs 16 kHz PCM; ignoring stream %u (%s at %u Hz)",
+			(unsigned)format.stream, format.encoding, format.sampleRate);
+	}
+}
+
+bool WhisperBackend::sendAudio(uint8_t id, const uint8_t *payload, size_t size)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = streams.find(id);
+	if (it == streams.end() || !it->second.usable || it->second.stopped) {
+		return false;
+	}
+
+	Stream &stream = it->second;
+	size_t count = size / sizeof(int16_t);
+	size_t start = stream.audio.size();
+	stream.audio.resize(start + count);
+	for (size_t i = 0; i < count; i++) {
+		int16_t sample;
+		memcpy(&sample, payload + i * sizeof(int16_t), sizeof(sample));
+		stream.audio[start + i] = sample / 32768.0f;
+	}
+	stream.undecoded += count;
+	if (stream.undecoded >= STEP_SAMPLES || stream.audio.size() >= MAX_UTTERANCE_SAMPLES) {
+		wake.notify_all();
+	}
+	return true;
+}
+
+void WhisperBackend::markSpeech(uint8_t id, bool speaking)
+{
+	if (speaking) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = streams.find(id);
+	if (it != streams.end()) {
+		it->second.finish = true;
+		wake.notify_all();
+	}
+}
+
+void WhisperBackend::stopAudio(uint8_t id)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = streams.find(id);
+	if (it != streams.end()) {
+		it->second.finish = true;
+		it->second.stopped = true;
+		wake.notify_all();
+	}
+}
+
+bool WhisperBackend::setTimer(Task task, void *param, int intervalMs)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	timerTask = task;
+	timerParam = param;
+	timerInterval = intervalMs;
+	timerWake.notify_all();
+	return running;
+}
+
+void WhisperBackend::stopThreads()
+{
+	// Called on the UI thread: the decoder gives up on a model still loading and aborts a
+	// decode in progress, so both joins return within one whisper.cpp compute step
+	aborting.store(true);
+	if (modelLoad) {
+		std::lock_guard<std::mutex> lock(modelLoad->mutex);
+		modelLoad->abandoned = true;
+		modelLoad->done.notify_all();
+	}
+	modelLoad.reset();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+		connected = false;
+		wake.notify_all();
+		timerWake.notify_all();
+	}
+	if (decoder.joinable()) {
+		decoder.join();
+	}
+	if (timer.joinable()) {
+		timer.join();
+	}
+}
+
+void WhisperBackend::timerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	auto due = std::chrono::steady_clock::now();
+	while (running) {
+		if (!timerTask || timerInterval <= 0) {
+			timerWake.wait(lock);
+			due = std::chrono::steady_clock::now();
+			continue;
+		}
+		due += std::chrono::milliseconds(timerInterval);
+		timerWake.wait_until(lock, due, [this, due]() {
+			return !running || !timerTask || std::chrono::steady_clock::now() >= due;
+		});
+		if (!running || !timerTask) {
+			continue;
+		}
+
+		// The task calls back into the audio methods, which take the mutex
+		Task task = timerTask;
+		void *param = timerParam;
+		lock.unlock();
+		task(param);
+		lock.lock();
+	}
+}
+
+void WhisperBackend::loadModel(std::shared_ptr<ModelLoad> load, std::string path)
+{
+	whisper_context_params params = whisper_context_default_params();
+	whisper_context *loaded = whisper_init_from_file_with_params(path.c_str(), params);
+
+	std::lock_guard<std::mutex> lock(load->mutex);
+	load->finished = true;
+	if (load->abandoned) {
+		if (loaded) {
+			whisper_free(loaded);
+		}
+		return;
+	}
+	load->context = loaded;
+	load->done.notify_all();
+}
+
+bool WhisperBackend::abort_callback(void *data)
+{
+	return static_cast<WhisperBackend *>(data)->aborting.load(std::memory_order_relaxed);
+}
+
+void WhisperBackend::decodeLoop(std::shared_ptr<ModelLoad> load)
+{
+	bool abandoned;
+	{
+		std::unique_lock<std::mutex> lock(load->mutex);
+		load->done.wait(lock, [&load]() { return load->finished || load->abandoned; });
+		context = load->context;
+		load->context = nullptr;
+		abandoned = load->abandoned;
+	}
+	if (abandoned) {
+		// Stopped while loading; the loader frees the model if it is not done yet
+		if (context) {
+			whisper_free(context);
+			context = nullptr;
+		}
+		return;
+	}
+	if (!context) {
+		obs_log(LOG_ERROR, "[Entei] Failed to load whisper model %s", modelPath.c_str());
+		if (connectHandler) {
+			connectHandler(false);
+		}
+		return;
+	}
+	obs_log(LOG_INFO, "[Entei] Loaded whisper model %s (%s)", modelPath.c_str(), language.c_str());
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		connected = running;
+	}
+	if (connectHandler) {
+		connectHandler(true);
+	}
+
+	std::vector<float> window;
+	bool warnedSlow = false;
+	for (;;) {
+		uint8_t id = 0;
+		uint64_t generation = 0;
+		bool final = false;
+		size_t taken = 0;
+		if (!nextJob(id, generation, window, final, taken)) {
+			break;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		std::string text = transcribe(window);
+		if (aborting.load()) {
+			break; // Stopping; the aborted window is incomplete
+		}
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+
+		Segment segment;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = streams.find(id);
+			// Restarted while decoding: the window belongs to audio that is gone
+			if (it == streams.end() || it->second.generation != generation) {
+				continue;
+			}
+			Stream &stream = it->second;
+			segment.id = stream.segmentId;
+			segment.text = text;
+			segment.isFinal = final;
+			segment.isRevision = stream.partialSent;
+			segment.source = stream.source;
+
+			if (final) {
+				// Audio that arrived while decoding opens the next utterance
+				stream.audio.erase(stream.audio.begin(), stream.audio.begin() + taken);
+				stream.undecoded = stream.audio.size();
+				stream.segmentId += 1.0;
+				stream.partialSent = false;
+				if (stream.stopped && stream.audio.empty()) {
+					streams.erase(it);
+				}
+			} else {
+				stream.partialSent = stream.partialSent || !text.empty();
+			}
+		}
+
+		// Each stream is decoded once per step of new audio, so a decode must fit in a step
+		if (!warnedSlow && elapsedMs > (long long)(STEP_SAMPLES * 1000 / WHISPER_RATE)) {
+			obs_log(LOG_WARNING, "[Entei] Whisper cannot keep up: %lld ms to decode %zu ms of audio",
+				elapsedMs, taken * 1000 / WHISPER_RATE);
+			warnedSlow = true;
+		}
+		// An empty partial has nothing to show; an empty final still closes a shown one
+		if ((!text.empty() || (final && segment.isRevision)) && segmentHandler) {
+			segmentHandler(segment);
+		}
+	}
+
+	whisper_free(context);
+	context = nullptr;
+}
+
+bool WhisperBackend::nextJob(uint8_t &id, uint64_t &generation, std::vector<float> &window, bool &final,
+			     size_t &taken)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		if (!running) {
+			return false;
+		}
+
+		// Take turns, starting after the stream decoded last
+		Stream *ready = nullptr;
+		for (size_t n = 1; n <= 256 && !ready; n++) {
+			auto it = streams.find((uint8_t)(lastDecoded + n));
+			if (it == streams.end()) {
+				continue;
+			}
+			Stream &stream = it->second;
+			if (stream.finish || stream.undecoded >= STEP_SAMPLES ||
+			    stream.audio.size() >= MAX_UTTERANCE_SAMPLES) {
+				ready = &stream;
+				id = it->first;
+			}
+		}
+		if (!ready) {
+			wake.wait(lock);
+			continue;
+		}
+
+		lastDecoded = id;
+		generation = ready->generation;
+		final = ready->finish || ready->audio.size() >= MAX_UTTERANCE_SAMPLES;
+		taken = std::min(ready->audio.size(), MAX_UTTERANCE_SAMPLES);
+		// A pause ends the utterance; if it ran past the limit, the rest is finalized next
+		ready->finish = ready->finish && ready->audio.size() > taken;
+		window.assign(ready->audio.begin(), ready->audio.begin() + taken);
+		ready->undecoded = ready->audio.size() - taken;
+		return true;
+	}
+}
+
+std::string WhisperBackend::transcribe(std::vector<float> &window)
+{
+	if (window.empty()) {
+		return std::string();
+	}
+	if (window.size() < MIN_WINDOW_SAMPLES) {
+		window.resize(MIN_WINDOW_SAMPLES, 0.0f);
+	}
+
+	whisper_full_params params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+	params.print_progress = false;
+	params.print_realtime = false;
+	params.print_timestamps = false;
+	params.print_special = false;
+	params.translate = false;
+	params.language = language.c_str();
+	params.n_threads = (int)std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+	// Each window is the whole utterance so far; earlier ones must not bias it
+	params.no_context = true;
+	params.single_segment = true;
+	params.abort_callback = abort_callback;
+	params.abort_callback_user_data = this;
+
+	if (whisper_full(context, params, window.data(), (int)window.size()) != 0) {
+		if (!aborting.load()) {
+			obs_log(LOG_WARNING, "[Entei] Whisper failed to transcribe %zu samples", window.size());
+		}
+		return std::string();
+	}
+
+	std::string text;
+	int segments = whisper_full_n_segments(context);
+	for (int i = 0; i < segments; i++) {
+		std::string part = trim_transcript(whisper_full_get_segment_text(context, i));
+		if (!part.empty()) {
+			text += text.empty() ? part : " " + part;
+		}
+	}
+	return text;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "transcription-backend.h"
+
+struct whisper_context;
+
+// In-process transcription with whisper.cpp, for setups where the plugin
+// and the model share a machine: no server, no sockets, no JSON.
+//
+// Audio from the uplink is buffered per stream as 16 kHz float. A decoder
+// thread re-transcribes each stream's open utterance whenever another
+// second of audio has arrived, sending it as a partial segment, and
+// finalizes it when the speaker pauses (speech_end with voice gating) or the
+// utterance reaches ten seconds. Streams take turns on the one model, so
+// the cost grows linearly with the number of speakers.
+//
+// Disconnecting never waits for the model: a decode in progress is aborted
+// through whisper.cpp's abort callback, and a model still loading is left to
+// a detached loader thread that frees it once it is done.
+//
+// Built with ENABLE_WHISPER; selected with a whisper://<model path> URL,
+// optionally followed by ?lang=<code>.
+class WhisperBackend : public TranscriptionBackend {
+public:
+	explicit WhisperBackend(const std::string &url);
+	~WhisperBackend() override;
+
+	bool connect() override;
+	void disconnect() override;
+	bool isConnected() const override;
+	void sendControl(const char *json) override;
+
+	bool acceptsOpus() const override { return false; }
+	void startAudio(const AudioFormat &format) override;
+	bool sendAudio(uint8_t stream, const uint8_t *payload, size_t size) override;
+	void markSpeech(uint8_t stream, bool speaking) override;
+	void stopAudio(uint8_t stream) override;
+	bool setTimer(Task task, void *param, int intervalMs) override;
+
+private:
+	struct Stream {
+		std::string source;
+		bool usable = false;     // 16 kHz PCM, the only thing the model takes
+		std::vector<float> audio; // Open utterance
+		size_t undecoded = 0;     // Samples that arrived since the last decode
+		bool finish = false;      // Finalize the utterance at the next decode
+		bool stopped = false;     // Remove once finalized
+		double segmentId = 0.0;
+		bool partialSent = false;
+		uint64_t generation = 0; // Bumped by startAudio, so a decode of the replaced audio is dropped
+	};
+
+	// Hands a loaded model from the detached loader thread to the decoder
+	struct ModelLoad {
+		std::mutex mutex;
+		std::condition_variable done;
+		whisper_context *context = nullptr;
+		bool finished = false;
+		bool abandoned = false; // The backend stopped first; whoever holds the model frees it
+	};
+
+	static void loadModel(std::shared_ptr<ModelLoad> load, std::string path);
+	static bool abort_callback(void *data);
+	void decodeLoop(std::shared_ptr<ModelLoad> load);
+	void timerLoop();
+	bool nextJob(uint8_t &id, uint64_t &generation, std::vector<float> &window, bool &final, size_t &taken);
+	std::string transcribe(std::vector<float> &window);
+	void stopThreads();
+
+	std::string modelPath;
+	std::string language;
+	whisper_context *context; // Decoder thread only
+	std::shared_ptr<ModelLoad> modelLoad;
+	std::atomic<bool> aborting; // Read by whisper.cpp between compute steps
+
+	mutable std::mutex mutex;
+	std::condition_variable wake;      // Decoder: audio or a pause to act on
+	std::condition_variable timerWake; // Timer: task changed or stopping
+	bool running;
+	bool connected;
+	std::map<uint8_t, Stream> streams;
+	uint8_t lastDecoded;
+
+	Task timerTask;
+	void *timerParam;
+	int timerInterval;
+
+	std::thread decoder;
+	std::thread timer;
+};
@@ -0,0 +1,120 @@
+#include "worker-pool.h"
+#include <obs-module.h>
+#include "plugin-support.h"
+
+WorkerPool::WorkerPool(size_t threads) : stopping(false)
+{
+	if (threads == 0) {
+		threads = 1;
+	}
+
+	for (size_t i = 0; i < threads; i++) {
+		workers.emplace_back([this]() { run(); });
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	cv.notify_all();
+
+	for (std::thread &worker : workers) {
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+}
+
+bool WorkerPool::post(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stopping) {
+			return false;
+		}
+		tasks.push_back(std::move(task));
+	}
+	cv.notify_one();
+	return true;
+}
+
+void WorkerPool::run()
+{
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (tasks.empty()) {
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		try {
+			task();
+		} catch (const std::exception &e) {
+			obs_log(LOG_ERROR, "Worker pool task exception: %s", e.what());
+		}
+	}
+}
+
+SerialQueue::SerialQueue(WorkerPool &pool) : pool(pool), running(false) {}
+
+SerialQueue::~SerialQueue()
+{
+	waitIdle();
+}
+
+void SerialQueue::post(std::function<void()> task)
+{
+	bool schedule = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+		if (!running) {
+			running = true;
+			schedule = true;
+		}
+	}
+
+	if (schedule && !pool.post([this]() { drain(); })) {
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.clear();
+		running = false;
+		idle.notify_all();
+	}
+}
+
+void SerialQueue::waitIdle()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this]() { return !running; });
+}
+
+void SerialQueue::drain()
+{
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (tasks.empty()) {
+				running = false;
+				idle.notify_all();
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		try {
+			task();
+		} catch (const std::exception &e) {
+			obs_log(LOG_ERROR, "Serial queue task exception: %s", e.what());
+		}
+	}
+}
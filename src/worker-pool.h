@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small fixed-size thread pool shared by all caption tracks.
+class WorkerPool {
+public:
+	explicit WorkerPool(size_t threads);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool &) = delete;
+	WorkerPool &operator=(const WorkerPool &) = delete;
+
+	// Returns false once the pool is shutting down
+	bool post(std::function<void()> task);
+
+private:
+	void run();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool stopping;
+};
+
+// Runs posted tasks one at a time and in order on a shared WorkerPool, so
+// per-track state never needs more than one worker at once.
+class SerialQueue {
+public:
+	explicit SerialQueue(WorkerPool &pool);
+	~SerialQueue();
+
+	SerialQueue(const SerialQueue &) = delete;
+	SerialQueue &operator=(const SerialQueue &) = delete;
+
+	void post(std::function<void()> task);
+	// Blocks until every posted task has finished
+	void waitIdle();
+
+private:
+	void drain();
+
+	WorkerPool &pool;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable idle;
+	bool running;
+};
@@ -0,0 +1,90 @@
+#include "audio-resampler.h"
+#include "test-support.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Feeds AudioResampler a second of tone in 10 ms buffers, as OBS does, and
+// checks the rate, level and frequency of what comes out at 16 kHz.
+
+struct Converted {
+	uint32_t outputRate = 0;
+	std::vector<int16_t> samples;
+};
+
+static Converted convert_tone(uint32_t rate, double frequency)
+{
+	AudioResampler resampler;
+	resampler.configure(rate, 1);
+
+	Converted result;
+	result.outputRate = resampler.outputRate();
+	size_t frames = rate / 100;
+	double step = 2.0 * 3.14159265358979323846 * frequency / rate;
+	std::vector<float> buffer(frames);
+	for (size_t offset = 0; offset < rate; offset += frames) {
+		for (size_t i = 0; i < frames; i++) {
+			buffer[i] = 0.5f * (float)std::sin(step * (offset + i));
+		}
+		resampler.processMono(buffer.data(), frames, result.samples);
+	}
+	return result;
+}
+
+// Skips the filter's start-up from silence
+static int peak(const std::vector<int16_t> &samples)
+{
+	int level = 0;
+	for (size_t i = samples.size() / 4; i < samples.size(); i++) {
+		level = std::max(level, std::abs((int)samples[i]));
+	}
+	return level;
+}
+
+static int zero_crossings(const std::vector<int16_t> &samples)
+{
+	int crossings = 0;
+	for (size_t i = samples.size() / 4 + 1; i < samples.size(); i++) {
+		crossings += (samples[i - 1] < 0) != (samples[i] < 0);
+	}
+	return crossings;
+}
+
+static void test_rate(uint32_t rate)
+{
+	int failures = test_failures();
+
+	// A 1 kHz tone at half scale keeps its level and frequency
+	Converted tone = convert_tone(rate, 1000.0);
+	CHECK(tone.outputRate == AudioResampler::TARGET_RATE);
+	CHECK(std::abs((int)tone.samples.size() - (int)AudioResampler::TARGET_RATE) <= 1);
+	CHECK(std::abs(peak(tone.samples) - 16384) < 16384 / 50);
+	// Three quarters of a second of 1 kHz crosses zero 1500 times
+	CHECK(std::abs(zero_crossings(tone.samples) - 1500) <= 2);
+
+	// A tone above the output Nyquist frequency is filtered out rather than aliased
+	Converted high = convert_tone(rate, 11000.0);
+	CHECK(peak(high.samples) < 16384 / 100);
+
+	if (test_failures() != failures) {
+		fprintf(stderr, "  (input at %u Hz)\n", rate);
+	}
+}
+
+int main()
+{
+	test_rate(48000);
+	test_rate(44100);
+
+	// 16 kHz input passes through unchanged
+	Converted same = convert_tone(16000, 1000.0);
+	CHECK(same.outputRate == 16000);
+	CHECK(same.samples.size() == 16000);
+	CHECK(same.samples[4] == (int16_t)std::lrint(0.5 * std::sin(2.0 * 3.14159265358979323846 * 0.25) * 32767.0));
+
+	if (test_failures() == 0) {
+		printf("audio-resampler: all tests passed\n");
+	}
+	return test_failures() == 0 ? 0 : 1;
+}
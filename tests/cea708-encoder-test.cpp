@@ -0,0 +1,179 @@
+#include "cea708-encoder.h"
+#include "test-support.h"
+
+// Reference cc_data streams for CaptionEncoder, worked out by hand from
+// CEA-608 (odd parity, doubled control codes) and CEA-708 (DTVCC packet and
+// service block headers, C1 command layout).
+
+typedef std::vector<uint8_t> Bytes;
+
+static Bytes finish(CaptionEncoder &encoder)
+{
+	Bytes data;
+	encoder.finish(data);
+	return data;
+}
+
+static Bytes repeat(uint8_t byte, size_t count)
+{
+	return Bytes(count, byte);
+}
+
+static Bytes concat(std::initializer_list<Bytes> parts)
+{
+	Bytes all;
+	for (const Bytes &part : parts) {
+		all.insert(all.end(), part.begin(), part.end());
+	}
+	return all;
+}
+
+// A DTVCC packet as triplets: the start triplet carries the header and the first payload byte
+static Bytes packet_triplets(uint8_t header, const Bytes &payload)
+{
+	Bytes data = {0xFF, header, payload[0]};
+	for (size_t i = 1; i < payload.size(); i += 2) {
+		data.insert(data.end(), {0xFE, payload[i], payload[i + 1]});
+	}
+	return data;
+}
+
+static void test_608_erase_displayed_memory()
+{
+	CaptionEncoder encoder;
+	encoder.clear608();
+	// EDM (14 2C), parity 94 2C, doubled
+	check_bytes("608 EDM", finish(encoder), {0xFC, 0x94, 0x2C, 0xFC, 0x94, 0x2C});
+
+	Bytes nothing;
+	CHECK(!encoder.finish(nothing));
+	CHECK(nothing.empty());
+}
+
+static void test_608_roll_up()
+{
+	CaptionEncoder encoder;
+	encoder.rollUp608("HI", 2);
+	check_bytes("608 roll-up", finish(encoder),
+		    {
+			    0xFC, 0x94, 0x25, 0xFC, 0x94, 0x25, // RU2
+			    0xFC, 0x94, 0xAD, 0xFC, 0x94, 0xAD, // CR
+			    0xFC, 0x94, 0x70, 0xFC, 0x94, 0x70, // PAC row 15, indent 0
+			    0xFC, 0xC8, 0x49,                   // "HI"
+		    });
+}
+
+static void test_608_pop_on_extended()
+{
+	CaptionEncoder encoder;
+	encoder.popOn608({"aÉ"});
+	check_bytes("608 pop-on", finish(encoder),
+		    {
+			    0xFC, 0x94, 0x20, 0xFC, 0x94, 0x20, // RCL
+			    0xFC, 0x94, 0xAE, 0xFC, 0x94, 0xAE, // ENM
+			    0xFC, 0x94, 0x70, 0xFC, 0x94, 0x70, // PAC row 15
+			    0xFC, 0x61, 0x45,                   // "a" and the fallback "E"
+			    0xFC, 0x92, 0xA1,                   // É (12 21), overwriting the fallback
+			    0xFC, 0x94, 0x2F, 0xFC, 0x94, 0x2F, // EOC
+		    });
+
+	// Clearing pop-on also erases the non-displayed memory
+	encoder.clear608();
+	check_bytes("608 pop-on clear", finish(encoder),
+		    {0xFC, 0x94, 0x2C, 0xFC, 0x94, 0x2C, 0xFC, 0x94, 0xAE, 0xFC, 0x94, 0xAE});
+}
+
+static void test_708_roll_up_and_clear()
+{
+	CaptionEncoder encoder;
+	encoder.rollUp708(1, "Hi", 2);
+	// Packet 0 of 16 bytes; service 1 block of 13 bytes; one null byte of padding
+	check_bytes("708 roll-up", finish(encoder),
+		    {
+			    0xFF, 0x08, 0x2D, // Packet header, service block header
+			    0xFE, 0x98, 0x38, // DefineWindow 0: visible, row and column locked
+			    0xFE, 0xDA, 0x32, // Anchored 90% down, 50% across
+			    0xFE, 0x71, 0x1F, // Lower centre anchor, 2 rows, 32 columns
+			    0xFE, 0x21, 0x92, // Roll-up window style, default pen; SetPenLocation
+			    0xFE, 0x01, 0x00, // Row 1, column 0
+			    0xFE, 0x0D, 0x48, // CR, "H"
+			    0xFE, 0x69, 0x00, // "i", padding
+		    });
+
+	// The window is already defined, so the next line is only CR and text
+	encoder.rollUp708(1, "Yo", 2);
+	check_bytes("708 roll-up line", finish(encoder), {0xFF, 0x43, 0x23, 0xFE, 0x0D, 0x59, 0xFE, 0x6F, 0x00});
+
+	// DeleteWindows for every window
+	encoder.clear708(1);
+	check_bytes("708 clear", finish(encoder), {0xFF, 0x82, 0x22, 0xFE, 0x8C, 0xFF});
+
+	// Nothing left to delete
+	encoder.clear708(1);
+	Bytes nothing;
+	CHECK(!encoder.finish(nothing));
+}
+
+static void test_708_extended_service()
+{
+	CaptionEncoder encoder;
+	encoder.popOn708(10, {"A"});
+	// Services 7 and up use the extended block header: 7 << 5 | size, then the service number
+	check_bytes("708 service 10", finish(encoder),
+		    {
+			    0xFF, 0x09, 0xEF, // Packet 0 of 18 bytes, extended header of 15 bytes
+			    0xFE, 0x0A, 0x98, // Service 10; DefineWindow 0
+			    0xFE, 0x18, 0xDA, // Hidden, row and column locked; anchor vertical
+			    0xFE, 0x32, 0x70, // Anchor horizontal; lower centre, 1 row
+			    0xFE, 0x1F, 0x09, // 32 columns; pop-up window style, default pen
+			    0xFE, 0x88, 0x01, // ClearWindows 0
+			    0xFE, 0x92, 0x00, // SetPenLocation row 0
+			    0xFE, 0x00, 0x41, // Column 0, "A"
+			    0xFE, 0x89, 0x01, // DisplayWindows 0
+		    });
+
+	// Service 63 is the last one; 64 is ignored
+	encoder.clear708(64);
+	encoder.rollUp708(64, "x", 2);
+	Bytes nothing;
+	CHECK(!encoder.finish(nothing));
+}
+
+static void test_708_blocks_across_packets()
+{
+	CaptionEncoder encoder;
+	encoder.popOn708(1, {std::string(32, 'A'), std::string(32, 'B'), std::string(32, 'C'), std::string(32, 'D')});
+
+	const Bytes defineWindow = {0x98, 0x18, 0xDA, 0x32, 0x73, 0x1F, 0x09};
+	const Bytes clearWindow = {0x88, 0x01};
+	const Bytes displayWindow = {0x89, 0x01};
+	auto pen = [](uint8_t row) { return Bytes{0x92, row, 0x00}; };
+
+	// 151 bytes of commands split into 31-byte service blocks without cutting a
+	// command in half; a fourth block would take the packet past 127 bytes
+	Bytes first = concat({{0x3F}, defineWindow, clearWindow, pen(0), repeat('A', 19)});
+	first = concat({first, {0x3F}, repeat('A', 13), pen(1), repeat('B', 15)});
+	first = concat({first, {0x3F}, repeat('B', 17), pen(2), repeat('C', 11), {0x00}});
+	Bytes second = concat({{0x3F}, repeat('C', 21), pen(3), repeat('D', 7)});
+	second = concat({second, {0x3B}, repeat('D', 25), displayWindow, {0x00}});
+	CHECK(first.size() == 97);
+	CHECK(second.size() == 61);
+
+	check_bytes("708 split", finish(encoder),
+		    concat({packet_triplets(0x31, first), packet_triplets(0x5F, second)}));
+}
+
+int main()
+{
+	test_608_erase_displayed_memory();
+	test_608_roll_up();
+	test_608_pop_on_extended();
+	test_708_roll_up_and_clear();
+	test_708_extended_service();
+	test_708_blocks_across_packets();
+
+	if (test_failures() == 0) {
+		printf("cea708-encoder: all tests passed\n");
+	}
+	return test_failures() == 0 ? 0 : 1;
+}
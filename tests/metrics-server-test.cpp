@@ -0,0 +1,128 @@
+#include "metrics-server.h"
+#include "test-support.h"
+
+#include <asio.hpp>
+
+#include <future>
+#include <thread>
+
+// Scrapes MetricsServer over loopback the way Prometheus does: one GET per
+// connection, read until the server closes it. The server runs on a private
+// io_context standing in for a track's WebSocket network thread.
+
+static std::string scrape(uint16_t port, const std::string &request)
+{
+	asio::io_context io;
+	asio::ip::tcp::socket socket(io);
+	std::error_code ec;
+	socket.connect(asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), port), ec);
+	if (ec) {
+		return std::string();
+	}
+	asio::write(socket, asio::buffer(request), ec);
+
+	std::string response;
+	char buffer[4096];
+	while (!ec) {
+		size_t size = socket.read_some(asio::buffer(buffer), ec);
+		response.append(buffer, size);
+	}
+	return response;
+}
+
+static bool contains(const std::string &text, const std::string &part)
+{
+	if (text.find(part) == std::string::npos) {
+		fprintf(stderr, "missing \"%s\"\n", part.c_str());
+		return false;
+	}
+	return true;
+}
+
+// A port nothing listens on right now
+static uint16_t free_port()
+{
+	asio::io_context io;
+	asio::ip::tcp::acceptor acceptor(io, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+	return acceptor.local_endpoint().port();
+}
+
+// Returns once the network thread has run everything posted before
+static void sync(asio::io_context &io)
+{
+	std::promise<void> done;
+	asio::post(io, [&done]() { done.set_value(); });
+	done.get_future().wait();
+}
+
+int main()
+{
+	PipelineMetrics metrics;
+	metrics.add(PipelineMetrics::MessagesReceived, 3);
+	metrics.add(PipelineMetrics::Connects);
+	metrics.add(PipelineMetrics::Disconnects);
+	metrics.adjust(PipelineMetrics::QueueDepth, 2);
+	metrics.record(PipelineMetrics::CaptionLatency, 400000); // 0.4 s
+	metrics.record(PipelineMetrics::CaptionLatency, 4000000);
+
+	asio::io_context io;
+	auto work = asio::make_work_guard(io);
+	std::thread network([&io]() { io.run(); });
+
+	MetricsServer server(metrics);
+	uint16_t port = free_port();
+	std::string error;
+	CHECK(server.start(io, port, error));
+	CHECK(server.running());
+
+	std::string response = scrape(port, "GET /metrics HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept: text/plain\r\n\r\n");
+	CHECK(response.compare(0, 17, "HTTP/1.1 200 OK\r\n") == 0);
+	CHECK(contains(response, "Content-Type: text/plain; version=0.0.4"));
+	CHECK(contains(response, "\r\n\r\n# HELP entei_messages_received_total "));
+	CHECK(contains(response, "# TYPE entei_messages_received_total counter\nentei_messages_received_total 3\n"));
+	CHECK(contains(response, "\nentei_connects_total 1\n"));
+	CHECK(contains(response, "\nentei_disconnects_total 1\n"));
+	CHECK(contains(response, "# TYPE entei_queue_depth gauge\nentei_queue_depth 2\n"));
+	CHECK(contains(response, "# TYPE entei_caption_latency_seconds histogram\n"));
+	CHECK(contains(response, "entei_caption_latency_seconds_bucket{le=\"0.25\"} 0\n"));
+	CHECK(contains(response, "entei_caption_latency_seconds_bucket{le=\"0.5\"} 1\n"));
+	CHECK(contains(response, "entei_caption_latency_seconds_bucket{le=\"3\"} 1\n"));
+	CHECK(contains(response, "entei_caption_latency_seconds_bucket{le=\"5\"} 2\n"));
+	CHECK(contains(response, "entei_caption_latency_seconds_bucket{le=\"+Inf\"} 2\n"));
+	CHECK(contains(response, "entei_caption_latency_seconds_count 2\n"));
+
+	// The body is exactly what Content-Length announces
+	size_t bodyStart = response.find("\r\n\r\n") + 4;
+	std::string length = "Content-Length: " + std::to_string(response.size() - bodyStart) + "\r\n";
+	CHECK(contains(response, length));
+
+	CHECK(scrape(port, "GET / HTTP/1.1\r\n\r\n").compare(0, 22, "HTTP/1.1 404 Not Found") == 0);
+	CHECK(scrape(port, "POST /metrics HTTP/1.1\r\n\r\n").compare(0, 31, "HTTP/1.1 405 Method Not Allowed") == 0);
+
+	// Counters are read at scrape time
+	metrics.add(PipelineMetrics::MessagesReceived, 2);
+	CHECK(contains(scrape(port, "GET /metrics HTTP/1.0\r\n\r\n"), "\nentei_messages_received_total 5\n"));
+
+	// Stopping closes the port; the listener comes back on the same one
+	server.stop();
+	CHECK(!server.running());
+	sync(io);
+	CHECK(scrape(port, "GET /metrics HTTP/1.1\r\n\r\n").empty());
+	CHECK(server.start(io, port, error));
+	CHECK(contains(scrape(port, "GET /metrics HTTP/1.1\r\n\r\n"), "\nentei_messages_received_total 5\n"));
+
+	// A port that is taken is reported, not thrown
+	MetricsServer second(metrics);
+	CHECK(!second.start(io, port, error));
+	CHECK(!error.empty());
+	CHECK(!second.running());
+
+	server.stop();
+	work.reset();
+	network.join();
+
+	if (test_failures() == 0) {
+		printf("metrics-server: all tests passed\n");
+	}
+	return test_failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Minimal assertions for the unit tests: each failure is printed and counted,
+// and main() returns test_failures() so CTest sees a non-zero exit.
+
+inline int &test_failures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition)                                                                  \
+	do {                                                                              \
+		if (!(condition)) {                                                       \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			test_failures()++;                                                \
+		}                                                                         \
+	} while (0)
+
+inline std::string hex_bytes(const std::vector<uint8_t> &bytes)
+{
+	std::string text;
+	char byte[4];
+	for (size_t i = 0; i < bytes.size(); i++) {
+		snprintf(byte, sizeof(byte), "%02X", bytes[i]);
+		text += i == 0 ? "" : i % 3 == 0 ? " | " : " ";
+		text += byte;
+	}
+	return text;
+}
+
+inline void check_bytes(const char *name, const std::vector<uint8_t> &actual, const std::vector<uint8_t> &expected)
+{
+	if (actual != expected) {
+		fprintf(stderr, "%s: bytes differ\n  expected: %s\n  actual:   %s\n", name, hex_bytes(expected).c_str(),
+			hex_bytes(actual).c_str());
+		test_failures()++;
+	}
+}